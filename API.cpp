@@ -101,6 +101,8 @@ void API::_process() {
 						double uptime(0.), cps(0.), r(0.), bpd(0.), miningPower(0.), difficulty(600.);
 						uint16_t patternLength(0U);
 						uint32_t shares(0ULL), sharesRejected(0ULL);
+						Stella::WorkSwitchLatencies workSwitchLatencies{};
+						Stella::BackpressureStats backpressureStats{};
 						if (_client != nullptr) {
 							const auto clientInfo(_client->info());
 							if (clientInfo.has_value()) {
@@ -111,6 +113,8 @@ void API::_process() {
 								cps = _cps;
 								r = _r;
 								bpd = _bpd;
+								workSwitchLatencies = _workSwitchLatencies;
+								backpressureStats = _backpressureStats;
 								difficulty = clientInfo->difficulty;
 								miningPower = 150.*bpd*std::pow(difficulty/600., static_cast<double>(patternLength) + 2.3)/86400.;
 								if (std::dynamic_pointer_cast<StratumClient>(_client)) {
@@ -127,7 +131,11 @@ void API::_process() {
 							oss << "\"bpd\": " << bpd << ", ";
 							oss << "\"miningpower\": " << miningPower << ", ";
 							oss << "\"shares\": " << shares << ", ";
-							oss << "\"sharesrejected\": " << sharesRejected << "}\n";
+							oss << "\"sharesrejected\": " << sharesRejected << ", ";
+							oss << "\"workswitchlatencies\": [" << Stella::formatContainer(workSwitchLatencies) << "], ";
+							oss << "\"backpressure\": {\"target\": " << backpressureStats.target << ", \"targetmin\": " << backpressureStats.targetMin << ", \"targetmax\": " << backpressureStats.targetMax << ", ";
+							oss << "\"lastremaining\": " << backpressureStats.lastRemainingTasks << ", \"lastqueuemin\": " << backpressureStats.lastQueuedTasksMin << ", \"checktaskrate\": " << backpressureStats.checkTaskRate << ", ";
+							oss << "\"decisions\": [" << Stella::formatContainer(backpressureStats.decisions) << "]}}\n";
 						}
 						else {
 							oss << (running ? "true" : "false") << "\n";
@@ -138,6 +146,8 @@ void API::_process() {
 							oss << miningPower << "\n";
 							oss << shares << "\n";
 							oss << sharesRejected << "\n";
+							oss << Stella::formatContainer(workSwitchLatencies) << "\n";
+							oss << backpressureStats.target << ", " << backpressureStats.targetMin << ", " << backpressureStats.targetMax << ", " << backpressureStats.lastRemainingTasks << ", " << backpressureStats.lastQueuedTasksMin << ", " << backpressureStats.checkTaskRate << ", " << Stella::formatContainer(backpressureStats.decisions) << "\n";
 						}
 						messageToSend = oss.str();
 					}
@@ -13,6 +13,8 @@ class API {
 	std::shared_ptr<Client> _client{nullptr};
 	
 	double _uptime{0.}, _cps{0.}, _r{0.}, _bpd{0.};
+	Stella::WorkSwitchLatencies _workSwitchLatencies{};
+	Stella::BackpressureStats _backpressureStats{};
 	
 	void _process();
 public:
@@ -38,6 +40,8 @@ public:
 	void setClient(const std::shared_ptr<Client> &client) {_client = client;}
 	
 	void setStats(const double, const double, const double, const double);
+	void setWorkSwitchLatencies(const Stella::WorkSwitchLatencies &workSwitchLatencies) {_workSwitchLatencies = workSwitchLatencies;}
+	void setBackpressureStats(const Stella::BackpressureStats &backpressureStats) {_backpressureStats = backpressureStats;}
 };
 
 #endif
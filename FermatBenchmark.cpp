@@ -0,0 +1,102 @@
+// (c) 2021-present Pttn (https://riecoin.xyz/rieMiner)
+// Compares the batched Fermat Test kernels (the assembly optimized ones) with GMP for every supported N_Size (number of 32 bits limbs), and checks that they agree.
+
+#include <chrono>
+#include <gmpxx.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ispc/fermat.h"
+
+constexpr int listSize(64); // Like a Check Task
+constexpr double minDuration(0.25); // Minimum time in s per N_Size and kernel
+
+static const mpz_class mpz2(2);
+static bool isPrimeFermat(const mpz_class& n) {
+	mpz_class r, nm1(n - 1);
+	mpz_powm(r.get_mpz_t(), mpz2.get_mpz_t(), nm1.get_mpz_t(), n.get_mpz_t());
+	return r == 1;
+}
+
+// Runs the kernel as many times as needed to measure it and returns the numbers tested per second. Returns 0 if the results are wrong.
+template <typename Kernel> double measure(const Kernel &kernel, const std::vector<uint32_t> &M, const std::vector<uint32_t> &expected) {
+	std::vector<uint32_t> isPrime(listSize), Mcopy;
+	uint64_t tested(0);
+	const auto start(std::chrono::steady_clock::now());
+	double duration(0.);
+	do {
+		Mcopy = M;
+		kernel(Mcopy.data(), isPrime.data());
+		if (isPrime != expected) return 0.;
+		tested += listSize;
+		duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (duration < minDuration);
+	return static_cast<double>(tested)/duration;
+}
+
+int main() {
+	__builtin_cpu_init();
+	const bool avx2(__builtin_cpu_supports("avx2")), avx512(__builtin_cpu_supports("avx512f")), ifma(avx512 && __builtin_cpu_supports("avx512ifma"));
+	gmp_randclass rng(gmp_randinit_mt);
+	std::cout << "Numbers tested per second, by N_Size (a dash means not supported by the CPU or the kernel)" << std::endl;
+	std::cout << std::setw(6) << "N_Size" << std::setw(12) << "GMP" << std::setw(12) << "AVX2" << std::setw(12) << "AVX-512" << std::setw(12) << "IFMA";
+#ifdef FERMAT_PROFILE
+	std::cout << std::setw(12) << "Setup %"; // Share of the fermatTest time (AVX2 and AVX-512 kernels) spent in setup_fermat
+#endif
+	std::cout << std::endl;
+	std::vector<int> nSizes; // Every size up to MAX_N_SIZE, then some larger ones like for record searches
+	for (int N_Size(1) ; N_Size <= MAX_N_SIZE ; N_Size++) nSizes.push_back(N_Size);
+	for (const int N_Size : {80, 96, 128, 192, 256, 384, IFMA_MAX_N_SIZE}) nSizes.push_back(N_Size);
+	for (const int N_Size : nSizes) {
+		const int bits(32*N_Size - 3);
+		// Same bit size for all the numbers, with some primes and consecutive ones like in a tuple. Finding primes takes a while for the large sizes, so only the first number is one for them.
+		std::vector<mpz_class> numbers;
+		mpz_class base(rng.get_z_bits(bits - 1));
+		mpz_setbit(base.get_mpz_t(), bits - 1);
+		mpz_nextprime(base.get_mpz_t(), base.get_mpz_t());
+		for (int i(0) ; i < listSize ; i++) {
+			if (N_Size > MAX_N_SIZE) numbers.push_back(base + 2*i);
+			else {
+				if (i % 4 == 0) mpz_nextprime(base.get_mpz_t(), base.get_mpz_t());
+				numbers.push_back(base + 2*(i % 4));
+			}
+		}
+		std::vector<uint32_t> M(listSize*N_Size, 0), expected(listSize);
+		for (int i(0) ; i < listSize ; i++) {
+			mpz_export(&M[i*N_Size], nullptr, -1, 4, 0, 0, numbers[i].get_mpz_t());
+			expected[i] = isPrimeFermat(numbers[i]);
+		}
+		std::vector<std::string> results;
+#ifdef FERMAT_PROFILE
+		uint64_t setupNsStart, kernelNsStart, numbersTested;
+		fermatProfileGet(&setupNsStart, &kernelNsStart, &numbersTested);
+#endif
+		results.push_back(std::to_string(static_cast<uint64_t>(measure([&](uint32_t*, uint32_t* isPrime) {
+			for (int i(0) ; i < listSize ; i++) isPrime[i] = isPrimeFermat(numbers[i]);
+		}, M, expected))));
+		const bool avxSize(N_Size >= 6 && N_Size <= MAX_N_SIZE);
+		for (const auto &[supported, kernel] : std::vector<std::pair<bool, void (*)(int, int, uint32_t*, uint32_t*)>>{
+			{avx2 && avxSize, [](int N_Size, int listSize, uint32_t* M, uint32_t* isPrime) {fermatTest(N_Size, listSize, M, isPrime, false);}},
+			{avx512 && avxSize, [](int N_Size, int listSize, uint32_t* M, uint32_t* isPrime) {fermatTest(N_Size, listSize, M, isPrime, true);}},
+			{ifma, fermatTestIfma}}) {
+			if (!supported) results.push_back("-");
+			else {
+				const double speed(measure([&](uint32_t* M, uint32_t* isPrime) {kernel(N_Size, listSize, M, isPrime);}, M, expected));
+				results.push_back(speed == 0. ? "Wrong!" : std::to_string(static_cast<uint64_t>(speed)));
+			}
+		}
+#ifdef FERMAT_PROFILE
+		uint64_t setupNs, kernelNs;
+		fermatProfileGet(&setupNs, &kernelNs, &numbersTested);
+		setupNs -= setupNsStart;
+		kernelNs -= kernelNsStart;
+		results.push_back(setupNs + kernelNs > 0 ? std::to_string(static_cast<uint64_t>(100.*static_cast<double>(setupNs)/static_cast<double>(setupNs + kernelNs))) : "-");
+#endif
+		std::cout << std::setw(6) << N_Size;
+		for (const auto &result : results) std::cout << std::setw(12) << result;
+		std::cout << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,24 @@
+#!/bin/sh
+
+# Compares the Separate and Interleaved Sieve Layouts for several constellation lengths, using the Benchmark Mode.
+# Usage: ./SieveLayoutBenchmark.sh [duration per run in s (default 120)] [other rieMiner options...]
+# Other options are passed to all the runs, for example Threads=8 Difficulty=1024. Compare the candidates/s and the time spent sieving.
+
+set -e
+
+miner=./rieMiner
+duration=${1:-120}
+[ $# -gt 0 ] && shift
+if ! test -x "${miner}" ; then
+	echo "${miner} not found, build rieMiner first."
+	exit 1
+fi
+
+for pattern in "0,2,4,2" "0,2,4,2,4" "0,4,2,4,2,4" "0,2,4,2,4,6,2" "0,2,4,2,4,6,2,6" "0,2,4,2,4,6,2,6,4,2,4,6"
+do
+	for layout in Separate Interleaved
+	do
+		echo "Pattern ${pattern}, ${layout} Layout"
+		"${miner}" SieveLayoutBenchmark Mode=Benchmark ConstellationPattern="${pattern}" SieveLayout="${layout}" BenchmarkTimeLimit="${duration}" BenchmarkBlockInterval=0 BenchmarkPrimeCountLimit=0 RefreshInterval=0 RawOutput=Yes "$@" < /dev/null | grep -E "candidates/s|Time spent"
+	done
+done
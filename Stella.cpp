@@ -9,17 +9,102 @@ namespace Stella {
 #define CPUID
 #endif
 #if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
 #include <sys/sysinfo.h>
 #elif defined(_WIN32)
+#include <processthreadsapi.h>
 #include <sysinfoapi.h>
 #endif
 
-SysInfo::SysInfo() : _os("Unknown/Unsupported"), _cpuArchitecture("Unknown"), _cpuBrand("Unknown"), _physicalMemory(0ULL), _avx(false), _avx2(false), _avx512(false) {
+#if defined(CPUID)
+static void cpuidCount(const uint32_t level, const uint32_t subLevel, uint32_t &eax, uint32_t &ebx, uint32_t &ecx, uint32_t &edx) { // See the level 7 comment below
+	asm ("cpuid\n\t"
+	    : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+	    : "0"(level), "2"(subLevel));
+}
+#endif
+
+#if defined(__linux__)
+static std::vector<uint16_t> parseCpuList(const std::string &cpuList) { // From the Sysfs format, e. g. "0-3,8-11"
+	std::vector<uint16_t> cpus;
+	std::stringstream cpuListStream(cpuList);
+	std::string range;
+	while (std::getline(cpuListStream, range, ',')) {
+		const std::size_t dash(range.find('-'));
+		try {
+			if (dash == std::string::npos) cpus.push_back(std::stoi(range));
+			else {
+				for (int cpu(std::stoi(range.substr(0, dash))) ; cpu <= std::stoi(range.substr(dash + 1)) ; cpu++)
+					cpus.push_back(cpu);
+			}
+		}
+		catch (...) {}
+	}
+	return cpus;
+}
+#endif
+
+SysInfo::SysInfo() : _os("Unknown/Unsupported"), _cpuArchitecture("Unknown"), _cpuBrand("Unknown"), _physicalMemory(0ULL), _l1DataCacheSize(0ULL), _l2CacheSize(0ULL), _l3CacheSize(0ULL), _l2SharingThreads(1), _l3SharingThreads(1), _avx(false), _avx2(false), _avx512(false), _avx512Ifma(false) {
 #if defined(__linux__)
 	_os = "Linux";
 	struct sysinfo si;
 	if (sysinfo(&si) == 0)
 		_physicalMemory = si.totalram;
+	// Cache sizes and sharing from the Sysfs, e. g. size = "2048K" and shared_cpu_list = "0-3,8-11".
+	for (uint32_t index(0) ; ; index++) {
+		const std::string cacheDirectory("/sys/devices/system/cpu/cpu0/cache/index"s + std::to_string(index) + "/"s);
+		std::ifstream levelFile(cacheDirectory + "level"s), typeFile(cacheDirectory + "type"s), sizeFile(cacheDirectory + "size"s), sharedFile(cacheDirectory + "shared_cpu_list"s);
+		if (!levelFile || !typeFile || !sizeFile)
+			break;
+		uint32_t level(0);
+		uint64_t size(0);
+		std::string type, unit, sharedCpus;
+		levelFile >> level;
+		typeFile >> type;
+		sizeFile >> size >> unit;
+		if (unit == "K") size <<= 10;
+		else if (unit == "M") size <<= 20;
+		uint16_t sharingThreads(0);
+		if (sharedFile && std::getline(sharedFile, sharedCpus))
+			sharingThreads = parseCpuList(sharedCpus).size();
+		sharingThreads = std::max(sharingThreads, static_cast<uint16_t>(1));
+		if (level == 1 && type == "Data") _l1DataCacheSize = size;
+		else if (level == 2 && type == "Unified") {
+			_l2CacheSize = size;
+			_l2SharingThreads = sharingThreads;
+		}
+		else if (level == 3 && type == "Unified") {
+			_l3CacheSize = size;
+			_l3SharingThreads = sharingThreads;
+		}
+	}
+	// Core Classes of hybrid CPUs, from the Intel Hybrid PMUs, e. g. cpus = "0-15" for cpu_core and "16-23" for cpu_atom, else from the capacities (Arm big.LITTLE).
+	std::ifstream performanceCpusFile("/sys/devices/cpu_core/cpus"), efficiencyCpusFile("/sys/devices/cpu_atom/cpus");
+	std::string performanceCpus, efficiencyCpus;
+	if (std::getline(performanceCpusFile, performanceCpus) && std::getline(efficiencyCpusFile, efficiencyCpus)) {
+		for (const auto &[cpuList, coreClass] : {std::make_pair(performanceCpus, CoreClass::Performance), std::make_pair(efficiencyCpus, CoreClass::Efficiency)}) {
+			for (const uint16_t cpu : parseCpuList(cpuList)) {
+				if (cpu >= _coreClasses.size()) _coreClasses.resize(cpu + 1, CoreClass::Performance);
+				_coreClasses[cpu] = coreClass;
+			}
+		}
+	}
+	else {
+		std::vector<uint64_t> capacities;
+		for (uint32_t cpu(0) ; ; cpu++) {
+			std::ifstream capacityFile("/sys/devices/system/cpu/cpu"s + std::to_string(cpu) + "/cpu_capacity"s);
+			uint64_t capacity(0);
+			if (!(capacityFile >> capacity))
+				break;
+			capacities.push_back(capacity);
+		}
+		if (!capacities.empty() && *std::min_element(capacities.begin(), capacities.end()) < *std::max_element(capacities.begin(), capacities.end())) {
+			for (const auto capacity : capacities)
+				_coreClasses.push_back(capacity == *std::max_element(capacities.begin(), capacities.end()) ? CoreClass::Performance : CoreClass::Efficiency);
+		}
+	}
 #elif defined(_WIN32)
 	_os = "Windows";
 	MEMORYSTATUSEX statex;
@@ -62,6 +147,35 @@ SysInfo::SysInfo() : _os("Unknown/Unsupported"), _cpuArchitecture("Unknown"), _c
 		    : "0"(level), "2"(zero));
 		_avx2 = (ebx & (1 << 5)) != 0;
 		_avx512 = (ebx & (1 << 16)) != 0;
+		_avx512Ifma = _avx512 && (ebx & (1 << 21)) != 0;
+	}
+	
+	// If the OS did not tell, get the caches from the Deterministic Cache Parameters (Leaf 4 for Intel, 0x8000001D for AMD).
+	if (_l1DataCacheSize == 0ULL && _l2CacheSize == 0ULL && _l3CacheSize == 0ULL) {
+		std::vector<uint32_t> cacheLevels;
+		__get_cpuid(0U, &eax, &ebx, &ecx, &edx);
+		if (eax >= 4U) cacheLevels.push_back(4U);
+		if (__get_cpuid_max(0x80000000U, nullptr) >= 0x8000001DU) cacheLevels.push_back(0x8000001DU);
+		for (const auto cacheLevel : cacheLevels) {
+			for (uint32_t subLevel(0) ; subLevel < 16U ; subLevel++) {
+				cpuidCount(cacheLevel, subLevel, eax, ebx, ecx, edx);
+				const uint32_t type(eax & 31U), level((eax >> 5U) & 7U);
+				if (type == 0U) break; // No more caches
+				const uint64_t size((static_cast<uint64_t>(ebx >> 22U) + 1ULL)*(((ebx >> 12U) & 1023ULL) + 1ULL)*((ebx & 4095ULL) + 1ULL)*(static_cast<uint64_t>(ecx) + 1ULL)); // Ways*Partitions*Line Size*Sets
+				const uint16_t sharingThreads(((eax >> 14U) & 4095U) + 1U);
+				if (level == 1U && type == 1U) _l1DataCacheSize = size;
+				else if (level == 2U && type == 3U) {
+					_l2CacheSize = size;
+					_l2SharingThreads = sharingThreads;
+				}
+				else if (level == 3U && type == 3U) {
+					_l3CacheSize = size;
+					_l3SharingThreads = sharingThreads;
+				}
+			}
+			if (_l1DataCacheSize != 0ULL || _l2CacheSize != 0ULL || _l3CacheSize != 0ULL)
+				break;
+		}
 	}
 #endif
 }
@@ -105,12 +219,178 @@ uint64_t mulMod(const uint64_t a, const uint64_t b, const uint64_t c) { // (ab)
 }
 #endif
 
+// Measures the sieving cost in ns per factor for the given Sieve Size, by sieving once with a sample of the primes and the given number of tables (to take in account the cache used by the other Sieves).
+static double measureSieveCost(const uint32_t *primes, const uint64_t nPrimes, const uint64_t tupleSize, const uint64_t sieveBits, const uint64_t sieveTables) {
+	const uint64_t sieveSize(1ULL << sieveBits), step(std::max<uint64_t>(nPrimes/16384ULL, 1ULL));
+	std::vector<uint64_t> tables(sieveTables*sieveSize/64ULL, 0ULL);
+	std::vector<uint32_t> factorsToEliminate;
+	uint64_t state(0x9E3779B97F4A7C15ULL); // Xorshift, for the random first factors
+	for (uint64_t i(0) ; i < nPrimes ; i += step) {
+		for (uint64_t f(0) ; f < tupleSize ; f++) {
+			state ^= state << 13ULL;
+			state ^= state >> 7ULL;
+			state ^= state << 17ULL;
+			factorsToEliminate.push_back(state % primes[i]);
+		}
+	}
+	double duration(INFINITY);
+	for (uint32_t run(0) ; run < 2 ; run++) { // Keep the best run to reduce the noise
+		const std::chrono::time_point<std::chrono::steady_clock> t0(std::chrono::steady_clock::now());
+		for (uint64_t i(0), j(0) ; i < nPrimes ; i += step) {
+			const uint64_t p(primes[i]), tableOffset(((i/step) % sieveTables)*sieveSize);
+			for (uint64_t f(0) ; f < tupleSize ; f++, j++) {
+				uint64_t factor(factorsToEliminate[j]);
+				for ( ; factor < sieveSize ; factor += p)
+					tables[(tableOffset + factor) >> 6ULL] |= 1ULL << (factor & 63ULL);
+				factorsToEliminate[j] = factor - sieveSize;
+			}
+		}
+		duration = std::min(duration, timeSince(t0));
+	}
+	volatile uint64_t sink(tables[state % tables.size()]); // Prevent the sieving from being optimized away
+	static_cast<void>(sink);
+	return 1e9*duration*static_cast<double>(step)/static_cast<double>(sieveSize);
+}
+
 constexpr uint64_t nPrimesTo2p32(203280221);
 constexpr int factorsCacheSize(16384);
 constexpr uint16_t maxSieveWorkers(64); // There is a noticeable performance penalty using Std Vector or Arrays so we are using Raw Arrays.
 thread_local uint64_t** factorsCache{nullptr};
 thread_local uint64_t** factorsCacheCounts{nullptr};
+thread_local uint16_t factorsCacheSieves(0); // The pooled Worker Threads keep their caches for the next Instances, they are only reallocated if these need more Sieves or Sieve Iterations
+thread_local uint64_t factorsCacheIterations(0);
+constexpr uint32_t extractionChunkWords(1024); // The candidates are extracted from the sieve and packed into Check Tasks by chunks of this many words
+thread_local uint32_t* extractedCandidates{nullptr}; // Room for the candidates of one chunk, plus the ones left from the previous chunk and the SIMD store overshoot
 thread_local uint16_t threadId(65535);
+#if defined(__linux__)
+thread_local std::optional<cpu_set_t> unpinnedCpuSet; // Affinity of a pooled Worker Thread before an Instance pinned it, restored if the next one does not
+#endif
+constexpr uint32_t freedCandidatesBatch(64); // The Candidates Pools blocks of the Check Tasks done are given back by batches, to not lock the pool for each Task
+thread_local std::vector<uint32_t> freedCandidates;
+thread_local uint16_t freedCandidatesWork(0);
+thread_local uint64_t freedCandidatesGeneration(0);
+struct TupleCandidate { // Candidate from any Check Task waiting for its next number to be tested by batches
+	uint32_t generation, jobId, offsetId; // The Work Generation and Job Id of its Check Task, as its Work Slot can be reused by a later Job while it is pending
+	uint64_t primorialFactor;
+	mpz_class number; // Next number of the tuple to test
+	uint32_t patternIndex, primeCount, offsetSum;
+};
+thread_local std::vector<TupleCandidate> tupleCandidates; // Only the first nTupleCandidates are pending, the other ones are kept to reuse the memory of their numbers
+thread_local uint64_t nTupleCandidates(0);
+struct FirstNumber { // Candidate whose first number was not tested yet. Most are composite, so they only become Tuple Candidates if it is prime
+	uint32_t generation, jobId, offsetId;
+	uint64_t primorialFactor;
+};
+thread_local std::vector<FirstNumber> firstNumbers; // Only the first nFirstNumbers are pending
+thread_local std::vector<uint32_t> firstNumbersM; // Their numbers, built directly in the layout of the Fermat Test Kernel and all with firstNumbersBits bits
+thread_local uint64_t nFirstNumbers(0);
+thread_local uint32_t firstNumbersBits(0);
+thread_local std::vector<uint64_t> tupleCounts;
+thread_local std::vector<uint32_t> fermatM; // Numbers given to the Fermat Test Kernel, grows to the largest size seen
+thread_local std::vector<uint32_t> candidateStartLimbs, candidateLimbs;
+thread_local mpz_class candidateStart, importedNumber, fermatR, fermatNm1;
+#if defined(__SSE2__) && defined(__AVX2__)
+constexpr uint64_t fermatBatchSize(16); // Job Size of the fermatTest
+#else
+constexpr uint64_t fermatBatchSize(1); // No Kernel, tested one by one with GMP
+#endif
+
+static void addMul32(uint32_t *r, const uint32_t n, const uint32_t *a, const uint32_t an, const uint32_t b) { // r += a*b, with r of n >= an 32 bits limbs large enough for the result
+	uint64_t carry(0);
+	uint32_t i(0);
+	for ( ; i < an ; i++) {
+		const uint64_t t(static_cast<uint64_t>(a[i])*b + r[i] + carry);
+		r[i] = static_cast<uint32_t>(t);
+		carry = t >> 32;
+	}
+	for ( ; carry != 0 && i < n ; i++) {
+		const uint64_t t(r[i] + carry);
+		r[i] = static_cast<uint32_t>(t);
+		carry = t >> 32;
+	}
+}
+
+static uint32_t bitLength32(const uint32_t *m, uint32_t n) {
+	while (n > 0 && m[n - 1] == 0) n--;
+	return n == 0 ? 0 : 32*n - __builtin_clz(m[n - 1]);
+}
+
+static void firstNumbersToTupleCandidates() { // Moves the pending First Numbers to the Tuple Candidates, which can be tested by batches of mixed sizes
+	const uint32_t N_Size((firstNumbersBits + 31)/32);
+	if (tupleCandidates.size() < nTupleCandidates + nFirstNumbers)
+		tupleCandidates.resize(nTupleCandidates + nFirstNumbers);
+	for (uint64_t j(0) ; j < nFirstNumbers ; j++) {
+		TupleCandidate &tupleCandidate(tupleCandidates[nTupleCandidates++]);
+		tupleCandidate.generation = firstNumbers[j].generation;
+		tupleCandidate.jobId = firstNumbers[j].jobId;
+		tupleCandidate.offsetId = firstNumbers[j].offsetId;
+		tupleCandidate.primorialFactor = firstNumbers[j].primorialFactor;
+		mpz_import(tupleCandidate.number.get_mpz_t(), N_Size, -1, 4, 0, 0, &firstNumbersM[j*N_Size]);
+		tupleCandidate.patternIndex = 0;
+		tupleCandidate.primeCount = 0;
+		tupleCandidate.offsetSum = 0;
+	}
+	nFirstNumbers = 0;
+}
+
+// Riecoin uses GMP's mpz_probab_prime_p for the PoW, but the Fermat Test is significantly faster and more suitable for the miner.
+// n is probably prime if a^(n - 1) ≡ 1 (mod n) for one 0 < a < p or more.
+static const mpz_class mpz2(2); // Here, we test with one a = 2.
+bool isPrimeFermat(const mpz_class& n) {
+	mpz_sub_ui(fermatNm1.get_mpz_t(), n.get_mpz_t(), 1); // Thread local variables, to not allocate at each call
+	mpz_powm(fermatR.get_mpz_t(), mpz2.get_mpz_t(), fermatNm1.get_mpz_t(), n.get_mpz_t()); // r = 2^(n - 1) % n
+	return fermatR == 1;
+}
+
+WorkerPool& WorkerPool::instance() {
+	static WorkerPool workerPool;
+	return workerPool;
+}
+
+WorkerPool::~WorkerPool() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_stopping = true;
+	_attachCv.notify_all();
+	assert(_runningThreads == 0); // The Instance must be stopped before exiting, the Workers would otherwise still use it
+	lock.unlock();
+	for (auto &thread : _threads)
+		thread.join();
+}
+
+void WorkerPool::_run(const uint16_t id) {
+	uint64_t attachment(0);
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		_attachCv.wait(lock, [&] {return _stopping || (_attachments != attachment && id < _attachedThreads);});
+		if (_stopping) return;
+		attachment = _attachments;
+		const std::function<void(uint16_t)> function(_function);
+		lock.unlock();
+		function(id);
+		lock.lock();
+		if (--_runningThreads == 0)
+			_detachCv.notify_all();
+	}
+}
+
+void WorkerPool::attach(const uint16_t threads, const std::function<void(uint16_t)> &function) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	assert(_runningThreads == 0);
+	while (_threads.size() < threads)
+		_threads.push_back(std::thread(&WorkerPool::_run, this, _threads.size()));
+	_function = function;
+	_attachedThreads = threads;
+	_runningThreads = threads;
+	_attachments++;
+	_attachCv.notify_all();
+}
+
+void WorkerPool::detach() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_detachCv.wait(lock, [this] {return _runningThreads == 0;});
+	_attachedThreads = 0;
+	_function = nullptr;
+}
 
 void Instance::init(const Configuration &configuration) {
 	_initMessages = {};
@@ -129,6 +409,10 @@ void Instance::init(const Configuration &configuration) {
 	}
 	
 	_pattern = configuration.pattern;
+	if (_pattern.size() >= maxTupleCounts) {
+		_initMessages.push_back("The Constellation Pattern is too long, it can have at most "s + std::to_string(maxTupleCounts - 1) + " numbers.\n"s);
+		return;
+	}
 	std::transform(_pattern.begin(), _pattern.end(), std::back_inserter(_halfPattern), [](uint64_t n) {return n >> 1;});
 	_patternMin = configuration.patternMin;
 	_primeCountTarget = configuration.primeCountTarget;
@@ -162,6 +446,31 @@ void Instance::init(const Configuration &configuration) {
 	_sieveWorkers = std::max(static_cast<int>(_sieveWorkers), 1);
 	_sieveWorkers = std::min(_sieveWorkers, maxSieveWorkers);
 	_sieveWorkers = std::min(static_cast<int>(_sieveWorkers), static_cast<int>(_primorialOffsets.size()));
+	// Several threads can cooperate on a same Sieve, each one eliminating the factors of a range of primes in its own table. This allows more sieving threads without multiplying the memory used for the factorsToEliminate.
+	_sievePartitions = std::clamp(static_cast<int>(configuration.sievePartitions), 1, static_cast<int>(_threads));
+	// With a Pipeline Depth > 1, the next Jobs can be presieved and sieved while the previous one is still sieving, which needs a set of Sieves for each.
+	_pipelineDepth = std::clamp(configuration.pipelineDepth, static_cast<uint16_t>(1U), maxPipelineDepth);
+	// On hybrid CPUs, the Workers are pinned to the Performance Cores first, then to the Efficiency ones. A Sieve continued by a slower Core would delay all its next Tasks, so the Efficiency Workers only take Check Tasks.
+	const std::vector<CoreClass> coreClasses(configuration.coreClasses.empty() ? sysInfo.getCoreClasses() : configuration.coreClasses);
+	std::vector<uint16_t> cpus; // Performance Cores first
+	for (const auto coreClass : {CoreClass::Performance, CoreClass::Efficiency}) {
+		for (uint16_t cpu(0) ; cpu < coreClasses.size() ; cpu++) {
+			if (coreClasses[cpu] == coreClass) cpus.push_back(cpu);
+		}
+	}
+	_workerCpus.assign(_threads, -1);
+	_workerCoreClasses.assign(_threads, CoreClass::Performance); // The Workers beyond the CPUs of the map are not pinned and take any Task
+	for (uint16_t i(0) ; i < std::min(static_cast<std::size_t>(_threads), cpus.size()) ; i++) {
+		_workerCpus[i] = cpus[i];
+		_workerCoreClasses[i] = coreClasses[cpus[i]];
+	}
+	const auto nEfficiencyWorkers(std::count(_workerCoreClasses.begin(), _workerCoreClasses.end(), CoreClass::Efficiency));
+	_coreClassScheduling = nEfficiencyWorkers > 0 && nEfficiencyWorkers < _threads;
+	if (!_coreClassScheduling) {
+		_workerCpus.assign(_threads, -1);
+		_workerCoreClasses.assign(_threads, CoreClass::Performance);
+	}
+	_jobPrefetch = std::max(configuration.jobPrefetch, static_cast<uint16_t>(1U));
 	
 	_primeTableLimit = configuration.primeTableLimit;
 	if (_primeTableLimit == 0) {
@@ -246,15 +555,43 @@ void Instance::init(const Configuration &configuration) {
 	primes.clear();
 
 	_sieveBits = configuration.sieveBits;
-	if (_sieveBits == 0) {
-		if (sysInfo.getCpuArchitecture() == "x64")
-			_sieveBits = _sieveWorkers <= 4 ? 25 : 24;
-		else
-			_sieveBits = _sieveWorkers <= 4 ? 23 : 22;
+	_sieveIterations = configuration.sieveIterations;
+	_sieveGeometryInfo = ""s;
+	if (_sieveBits == 0) { // Choose the Sieve Size (and the Iterations if not set) using the caches and measurements of the sieving costs
+		const uint64_t sieveTables(_sieveWorkers*_sievePartitions), sieveBitsMin(22), sieveBitsMax(sysInfo.getCpuArchitecture() == "x64" ? 25 : 23);
+		uint64_t lastLevelCache(sysInfo.getL3CacheSize()), lastLevelCacheSharingThreads(sysInfo.getL3SharingThreads());
+		if (lastLevelCache == 0) {
+			lastLevelCache = sysInfo.getL2CacheSize();
+			lastLevelCacheSharingThreads = sysInfo.getL2SharingThreads();
+		}
+		const uint64_t usedCpus(std::clamp<uint64_t>(std::thread::hardware_concurrency(), 1ULL, _threads));
+		lastLevelCache *= (usedCpus + lastLevelCacheSharingThreads - 1ULL)/lastLevelCacheSharingThreads; // The Threads may be spread over several cache instances
+		// Larger Sieves amortize better the cost of going through the primes at each Iteration, but the factors elimination becomes more expensive if all the tables do not fit in the cache.
+		// Measure the sieving cost per factor for each Size, keeping factorMax (and therefore the memory usage) at the former default 16*2^25 if the Iterations are not set.
+		double bestCost(INFINITY);
+		_sieveGeometryInfo = "Sieve Geometry: "s + std::to_string(sieveTables) + " table(s), "s + (lastLevelCache > 0 ? std::to_string(lastLevelCache >> 20) + " MiB last level cache"s : "unknown caches"s) + ", measured ns per factor:"s;
+		for (uint64_t sieveBits(sieveBitsMin) ; sieveBits <= sieveBitsMax ; sieveBits++) {
+			if (sieveBits > sieveBitsMin && lastLevelCache > 0 && (sieveTables << (sieveBits - 3ULL)) > 2ULL*lastLevelCache)
+				break; // Clearly too large
+			const uint64_t sieveIterations(_sieveIterations != 0 ? _sieveIterations : std::max<uint64_t>((1ULL << 29ULL) >> sieveBits, 16ULL));
+			const uint64_t firstPrimeIndex(std::min<uint64_t>(_primes32.size(), 100ULL)); // Roughly skip the primorial primes
+			const uint64_t nPrimesToSieve(std::lower_bound(_primes32.begin(), _primes32.end(), sieveIterations << sieveBits) - _primes32.begin());
+			if (nPrimesToSieve <= firstPrimeIndex)
+				break;
+			const double cost(measureSieveCost(&_primes32[firstPrimeIndex], nPrimesToSieve - firstPrimeIndex, _pattern.size(), sieveBits, sieveTables));
+			_sieveGeometryInfo += " "s + std::to_string(sieveBits) + ": "s + doubleToString(cost, 2);
+			if (cost < bestCost) {
+				bestCost = cost;
+				_sieveBits = sieveBits;
+			}
+		}
+		if (_sieveBits == 0)
+			_sieveBits = sieveBitsMin;
+		if (_sieveIterations == 0)
+			_sieveIterations = std::max<uint64_t>((1ULL << 29ULL) >> _sieveBits, 16ULL);
 	}
 	_sieveSize = 1 << _sieveBits;
 	_sieveWords = _sieveSize/64;
-	_sieveIterations = configuration.sieveIterations;
 	if (_sieveIterations == 0)
 		_sieveIterations = 16;
 	_factorMax = _sieveIterations*_sieveSize;
@@ -278,6 +615,8 @@ void Instance::init(const Configuration &configuration) {
 		if (i + 1 == _primes32.size())
 			_primorialNumber = i + 1;
 	}
+	_primorialLimbs.assign((mpz_sizeinbase(_primorial.get_mpz_t(), 2) + 31)/32, 0);
+	mpz_export(_primorialLimbs.data(), nullptr, -1, 4, 0, 0, _primorial.get_mpz_t());
 	_primorialOffsetDiff.resize(_sieveWorkers - 1);
 	_patternCumulative = std::vector<uint64_t>(_pattern.size(), 0);
 	std::partial_sum(_pattern.begin(), _pattern.end(), _patternCumulative.begin(), std::plus<uint64_t>());
@@ -325,10 +664,12 @@ void Instance::init(const Configuration &configuration) {
 	_modularInversesGenerationTime = timeSince(t0);
 	
 	uint64_t additionalFactorsCountEstimation(0); // tupleSize*factorMax*(sum of 1/p, for p in the prime table >= factorMax); it is the estimation of how many such p will eliminate a factor (factorMax/p being the probability of the modulo p being < factorMax)
-	double sumInversesOfPrimes(0.);
+	double sumInversesOfPrimes(0.), survivalRatio(1.); // The latter is the product of (1 - PatternLength/p) for the sieving primes, the part of a Sieve not eliminated
 	_primesIndexThreshold = 0; // Number of prime numbers smaller than factorMax in the table
 	for (uint64_t i(0) ; i < _nPrimes ; i++) {
 		const uint64_t p(_getPrime(i));
+		if (i >= _primorialNumber)
+			survivalRatio *= 1. - static_cast<double>(_pattern.size())/static_cast<double>(p);
 		if (p >= _factorMax) {
 			if (_primesIndexThreshold == 0) {
 				_primesIndexThreshold = i;
@@ -340,21 +681,67 @@ void Instance::init(const Configuration &configuration) {
 	}
 	if (_primesIndexThreshold == 0)
 		_primesIndexThreshold = _nPrimes;
-	const uint64_t factorsToEliminateEntries(_pattern.size()*_primesIndexThreshold); // PatternLength entries for every prime < factorMax
+	// With the Interleaved Layout, each prime has a record of its PatternLength entries, padding to allow SIMD processing, and the prime itself in the last lane, so sieving with a prime only needs one stream of memory.
+	_interleavedSieveLayout = configuration.interleavedSieveLayout;
+	_factorsToEliminateStride = _interleavedSieveLayout ? ((_pattern.size() + 1 + 3) & ~3ULL) : _pattern.size();
+	const uint64_t factorsToEliminateEntries(_factorsToEliminateStride*_primesIndexThreshold); // PatternLength entries (or a record) for every prime < factorMax
+	// Sieving with p costs about sieveSize/p eliminations plus a constant, balance the Sieve Partitions accordingly. The bounds must be even to use SIMD sieving optimizations.
+	_sievePartitionsBounds = std::vector<uint64_t>(_sievePartitions + 1, _primesIndexThreshold);
+	_sievePartitionsBounds[0] = _primorialNumber;
+	if (_sievePartitions > 1) {
+		double sieveCost(0.);
+		for (uint64_t i(_primorialNumber) ; i < _primesIndexThreshold ; i++)
+			sieveCost += 1. + static_cast<double>(_sieveSize)/static_cast<double>(_primes32[i]);
+		double partitionCost(0.);
+		uint32_t partition(1);
+		for (uint64_t i(_primorialNumber) ; i < _primesIndexThreshold && partition < _sievePartitions ; i++) {
+			partitionCost += 1. + static_cast<double>(_sieveSize)/static_cast<double>(_primes32[i]);
+			if (partitionCost >= sieveCost*static_cast<double>(partition)/static_cast<double>(_sievePartitions)) {
+				_sievePartitionsBounds[partition] = std::max<uint64_t>((i + 2) & ~1ULL, _sievePartitionsBounds[partition - 1]);
+				partition++;
+			}
+		}
+	}
+	// Same for the cancellation chunks, so a Sieve Task aborted because of a new Block stops after at most about 1/sieveCancellationChunks of its work.
+	_sieveChunksBounds.clear();
+	{
+		double sieveCost(0.);
+		for (uint64_t i(_primorialNumber) ; i < _primesIndexThreshold ; i++)
+			sieveCost += 1. + static_cast<double>(_sieveSize)/static_cast<double>(_primes32[i]);
+		double chunkCost(0.);
+		for (uint64_t i(_primorialNumber) ; i < _primesIndexThreshold && _sieveChunksBounds.size() + 1 < sieveCancellationChunks ; i++) {
+			chunkCost += 1. + static_cast<double>(_sieveSize)/static_cast<double>(_primes32[i]);
+			if (chunkCost >= sieveCost*static_cast<double>(_sieveChunksBounds.size() + 1)/static_cast<double>(sieveCancellationChunks) && ((i + 2) & ~1ULL) < _primesIndexThreshold)
+				_sieveChunksBounds.push_back(std::max<uint64_t>((i + 2) & ~1ULL, _sieveChunksBounds.empty() ? 0 : _sieveChunksBounds.back()));
+		}
+		_sieveChunksBounds.push_back(_primesIndexThreshold);
+	}
 	additionalFactorsCountEstimation = _pattern.size()*ceil(static_cast<double>(_factorMax)*sumInversesOfPrimes);
 	const uint64_t additionalFactorsEntriesPerIteration(17ULL*(additionalFactorsCountEstimation/_sieveIterations)/16ULL + 64ULL); // Have some margin
 	try {
-		_sieves = std::vector<Sieve>(_sieveWorkers);
+		_sieves = std::vector<Sieve>(_pipelineDepth*_sieveWorkers);
 		for (std::vector<Sieve>::size_type i(0) ; i < _sieves.size() ; i++) {
-			_sieves[i].id = i;
+			_sieves[i].id = i % _sieveWorkers;
 			_sieves[i].additionalFactorsToEliminateCounts = new std::atomic<uint64_t>[_sieveIterations];
 			_sieves[i].factorsTable = new uint64_t[_sieveWords];
+			_sieves[i].partFactorsTables = new uint64_t*[_sievePartitions];
+			_sieves[i].partFactorsTables[0] = _sieves[i].factorsTable;
+			for (uint32_t j(1) ; j < _sievePartitions ; j++)
+				_sieves[i].partFactorsTables[j] = new uint64_t[_sieveWords];
+			_sieves[i].nRemainingPartitions = _sievePartitions;
 #ifdef __SSE2__
 			_sieves[i].factorsToEliminate = reinterpret_cast<uint32_t*>(new __m256i[(factorsToEliminateEntries + 7) / 8]);
 #else
 			_sieves[i].factorsToEliminate = new uint32_t[factorsToEliminateEntries];
 #endif
 			memset(_sieves[i].factorsToEliminate, 0, sizeof(uint32_t)*factorsToEliminateEntries);
+			if (_interleavedSieveLayout) {
+				for (uint64_t j(0) ; j < _primesIndexThreshold ; j++) {
+					uint32_t *record(&_sieves[i].factorsToEliminate[j*_factorsToEliminateStride]);
+					std::fill(record + _pattern.size(), record + _factorsToEliminateStride - 1, 0x7FFFFFFFU);
+					record[_factorsToEliminateStride - 1] = _primes32[j];
+				}
+			}
 			_sieves[i].additionalFactorsToEliminate = new uint32_t*[_sieveIterations];
 			for (uint64_t j(0) ; j < _sieveIterations ; j++)
 				_sieves[i].additionalFactorsToEliminate[j] = new uint32_t[additionalFactorsEntriesPerIteration];
@@ -364,37 +751,92 @@ void Instance::init(const Configuration &configuration) {
 		_initMessages.push_back("Unable to allocate memory for the sieves. Try to reduce the PrimeTableLimit parameter.\n"s);
 		return;
 	}
+	_works = std::vector<MinerWork>(_pipelineDepth + 1);
+	// Cap the memory for the candidates, the Sieve Tasks being throttled before it runs out. It must still allow an iteration of every Sieve when the throttling starts (a quarter left), otherwise candidates would be dropped.
+	_candidatesPerIteration = std::ceil(survivalRatio*static_cast<double>(_sieveSize));
+	const uint64_t minCandidatesPoolBlocks(8ULL*_sieveWorkers*((_candidatesPerIteration + maxCandidatesPerCheckTask - 1)/maxCandidatesPerCheckTask)); // With a 2x margin
+	_candidatesPoolBlocks = std::max((configuration.candidatesPoolSize << 20)/(maxCandidatesPerCheckTask*sizeof(uint32_t))/_works.size(), minCandidatesPoolBlocks);
+	_candidatesPoolBlocks = std::min((_candidatesPoolBlocks + candidatesSlabBlocks - 1)/candidatesSlabBlocks, static_cast<uint64_t>(candidatesMaxSlabs))*candidatesSlabBlocks;
+	for (auto &work : _works)
+		work.candidatesPool.limit(_candidatesPoolBlocks/candidatesSlabBlocks);
 	// Initial guess at a value for the Target.
-	_nRemainingCheckTasksTarget = 32U*_threads*_sieveWorkers;
+	_backpressure.init(_threads, 32U*_threads*_sieveWorkers, std::max(configuration.backpressureQueuePerThread, static_cast<uint16_t>(1U)), configuration.backpressureMaxStaleTime);
+	_adaptiveSieveDepth = configuration.adaptiveSieveDepth;
+	_nPrimesEffective = _nPrimes & ~1ULL; // The sieving processes the primes by pairs, the bounds must be even.
 	_inited = true;
 }
 
 void Instance::startThreads() {
 	assert(_inited && !_running);
 	_running = true;
-	if (!_keepStats)
-		_tupleCounts = std::vector<uint64_t>(_pattern.size() + 1, 0ULL);
+	{
+		std::lock_guard<std::mutex> lock(_countersMutex);
+		if (!_keepStats)
+			_keptCounters.clear();
+		else if (_nTupleCounts != _pattern.size() + 1) { // The Tuple Length changed (in case of a Fork), the kept Tuple Counts are not comparable anymore
+			for (auto &tupleCount : _keptCounters.tupleCounts) tupleCount = 0;
+		}
+		_nTupleCounts = _pattern.size() + 1;
+		_workerCounters = std::make_unique<WorkerCounters[]>(_threads);
+	}
+	if (!_keepStats) {
+		_jobsStarted = 0;
+		_jobWaitTimeTotal = 0;
+		_droppedCandidates = 0;
+		_resultsVerified = 0;
+		_resultsDiscarded = 0;
+		_pseudoprimes = 0;
+		_verificationLatencyTotal = 0;
+		_verificationLatencyMax = 0;
+		for (auto &workSwitchLatency : _workSwitchLatencies) workSwitchLatency = 0;
+	}
 	_keepStats = false;
-	_masterThread = std::thread(&Instance::_manageTasks, this);
+	_workerTasks.clear();
 	for (uint16_t i(0) ; i < _threads ; i++)
-		_workerThreads.push_back(std::thread(&Instance::_doTasks, this, i));
+		_workerTasks.push_back(std::make_unique<WsDeque<Task, workerDequeCapacity>>());
+	_nQueuedTasks = 0;
+	_nQueuedCheckTasks = 0;
+	_nSleepingWorkers = 0;
+	_workerGenerations = std::make_unique<WorkerGeneration[]>(_threads);
+	_workGeneration = 0;
+	_workSwitchPending = false;
+	_verifierThread = std::thread(&Instance::_verifyResults, this);
+	_masterThread = std::thread(&Instance::_manageTasks, this);
+	WorkerPool::instance().attach(_threads, [this](const uint16_t id) {_doTasks(id);});
 }
 
 void Instance::stopThreads() {
 	assert(_running);
 	_running = false;
 	invalidateWork();
-	_tasksDoneInfos.push_front(TaskDoneInfo{Task::Type::Dummy, {}}); // Unblock if master thread stuck in blocking_pop_front().
+	_notifyMaster(); // Unblock the Master Thread if it is waiting for a milestone.
+	{
+		std::lock_guard<std::mutex> lock(_presieveMutex);
+		_presieveCv.notify_all(); // Unblock the Sieves waiting for Presieve Tasks that will not be done.
+	}
 	_masterThread.join();
-	for (uint16_t i(0) ; i < _threads ; i++)
-		_tasks.push_front(Task{Task::Type::Dummy, 0, {}}); // Unblock worker threads stuck in blocking_pop_front().
-	for (auto &workerThread : _workerThreads)
-		workerThread.join();
-	_workerThreads.clear();
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_sleepCv.notify_all(); // Wake up the sleeping Workers so they can see that they must stop.
+	}
+	WorkerPool::instance().detach();
+	_resultsToVerify.push_back(ResultToVerify{true, {}, {}}); // The Results found before are still verified
+	_verifierThread.join();
+	{
+		std::lock_guard<std::mutex> lock(_countersMutex);
+		for (uint16_t i(0) ; i < _threads ; i++)
+			_keptCounters.add(_workerCounters[i]);
+		_workerCounters.reset();
+	}
 	_availableJobs.clear();
 	_presieveTasks.clear();
-	_tasks.clear();
-	_tasksDoneInfos.clear();
+	_frontTasks.clear();
+	_backTasks.clear();
+	_lookaheadTasks.clear();
+	_checkTasks.clear();
+	for (auto &workerTasks : _workerTasks) workerTasks->clear();
+	_nQueuedTasks = 0;
+	_nQueuedCheckTasks = 0;
 	for (auto &work : _works) work.clear();
 }
 
@@ -403,6 +845,9 @@ void Instance::clear() {
 	_inited = false;
 	for (auto &sieve : _sieves) {
 		delete[] sieve.factorsTable;
+		for (uint32_t j(1) ; j < _sievePartitions ; j++)
+			delete[] sieve.partFactorsTables[j];
+		delete[] sieve.partFactorsTables;
 #ifdef __SSE2__
 		delete[] reinterpret_cast<__m256i*>(sieve.factorsToEliminate);
 #else
@@ -414,6 +859,7 @@ void Instance::clear() {
 		delete[] sieve.additionalFactorsToEliminateCounts;
 	}
 	_sieves.clear();
+	_works.clear();
 	_primes32.clear();
 	_primes64.clear();
 	_modularInverses32.clear();
@@ -426,6 +872,8 @@ void Instance::clear() {
 	_pattern.clear();
 	_halfPattern.clear();
 	_primorialOffsetDiff.clear();
+	_sievePartitionsBounds.clear();
+	_sieveChunksBounds.clear();
 	_patternMin.clear();
 }
 
@@ -446,11 +894,12 @@ void Instance::_addCachedAdditionalFactorsToEliminate(Sieve& sieve, uint64_t *fa
 void Instance::_doPresieveTask(const Task &task) {
 	const uint64_t workIndex(task.workIndex), firstPrimeIndex(task.presieve.start), lastPrimeIndex(task.presieve.end);
 	const mpz_class firstCandidate(_works[workIndex].primorialMultipleStart + _primorialOffsets[0]);
+	Sieve *sieves(&_sieve(workIndex, 0)); // The Sieves of the Job's set
 	std::array<int, maxSieveWorkers> factorsCacheTotalCounts{0};
 	uint64_t** factorsCacheRef(factorsCache); // On Windows, caching these thread_local pointers on the stack makes a noticeable perf difference.
 	uint64_t** factorsCacheCountsRef(factorsCacheCounts);
 #ifdef __SSE2__
-	const uint64_t precompLimit(_modPrecompute.size()), tupleSize(_pattern.size());
+	const uint64_t precompLimit(_modPrecompute.size()), factorsToEliminateStride(_factorsToEliminateStride);
 	uint64_t avxLimit(0);
 #ifdef __AVX2__
 	const uint64_t avxWidth(8);
@@ -464,9 +913,11 @@ void Instance::_doPresieveTask(const Task &task) {
 	uint64_t nextRemainder[8];
 	uint64_t nextRemainderIndex(8);
 #else
-	const uint64_t tupleSize(_pattern.size());
+	const uint64_t factorsToEliminateStride(_factorsToEliminateStride);
 #endif
 	for (uint64_t i(firstPrimeIndex) ; i < lastPrimeIndex ; i++) {
+		if ((i & (presieveCancellationPrimes - 1)) == 0 && !_works[workIndex].current) // Also check regularly for the primes < factorMax, which do not use the factors cache
+			return;
 		const uint64_t p(_getPrime(i));
 		uint64_t mi[4];
 		mi[0] = _getModularInverse(i); // Modular inverse of the primorial: mi[0]*primorial ≡ 1 (mod p). The modularInverses were precomputed in init().
@@ -536,18 +987,18 @@ void Instance::_doPresieveTask(const Task &task) {
 		// We use a macro here to ensure the compiler inlines the code, and also make it easier to early out of the function completely if the current height has changed.
 #define addFactorsToEliminateForP(sieveWorkerIndex) {						                                                   \
 			if (i < _primesIndexThreshold) {			                                                                       \
-				_sieves[sieveWorkerIndex].factorsToEliminate[tupleSize*i] = fp;		                                           \
+				sieves[sieveWorkerIndex].factorsToEliminate[factorsToEliminateStride*i] = fp;		                               \
 				for (std::vector<uint64_t>::size_type f(1) ; f < _halfPattern.size() ; f++) {		                           \
 					if (fp < mi[_halfPattern[f]]) fp += p;	                                                                   \
 					fp -= mi[_halfPattern[f]];	                                                                               \
-					_sieves[sieveWorkerIndex].factorsToEliminate[tupleSize*i + f] = fp;	                                       \
+					sieves[sieveWorkerIndex].factorsToEliminate[factorsToEliminateStride*i + f] = fp;	                           \
 				}		                                                                                                       \
 			}			                                                                                                       \
 			else {			                                                                                                   \
 				if (factorsCacheTotalCounts[sieveWorkerIndex] + _halfPattern.size() >= factorsCacheSize) {		               \
 					if (!_works[workIndex].current)	                                                                           \
 						return;                                                                                                \
-					_addCachedAdditionalFactorsToEliminate(_sieves[sieveWorkerIndex], factorsCacheRef[sieveWorkerIndex], factorsCacheCountsRef[sieveWorkerIndex], factorsCacheTotalCounts[sieveWorkerIndex]); \
+					_addCachedAdditionalFactorsToEliminate(sieves[sieveWorkerIndex], factorsCacheRef[sieveWorkerIndex], factorsCacheCountsRef[sieveWorkerIndex], factorsCacheTotalCounts[sieveWorkerIndex]); \
 					factorsCacheTotalCounts[sieveWorkerIndex] = 0;	                                                           \
 				}		                                                                                                       \
 				if (fp < _factorMax) {		                                                                                   \
@@ -608,7 +1059,7 @@ void Instance::_doPresieveTask(const Task &task) {
 	if (lastPrimeIndex > _primesIndexThreshold) {
 		for (int j(0) ; j < _sieveWorkers ; j++) {
 			if (factorsCacheTotalCounts[j] > 0) {
-				_addCachedAdditionalFactorsToEliminate(_sieves[j], factorsCacheRef[j], factorsCacheCountsRef[j], factorsCacheTotalCounts[j]);
+				_addCachedAdditionalFactorsToEliminate(sieves[j], factorsCacheRef[j], factorsCacheCountsRef[j], factorsCacheTotalCounts[j]);
 				factorsCacheTotalCounts[j] = 0;
 			}
 		}
@@ -903,46 +1354,333 @@ void Instance::_processSieve8_avx2(uint64_t *factorsTable, uint32_t* factorsToEl
 #endif
 #endif
 
-void Instance::_doSieveTask(Task task) {
-	Sieve& sieve(_sieves[task.sieve.id]);
-	std::unique_lock<std::mutex> presieveLock(sieve.presieveLock, std::defer_lock);
-	const uint64_t workIndex(task.workIndex), sieveIteration(task.sieve.iteration), firstPrimeIndex(_primorialNumber);
+// Sieving with the Interleaved Layout, where p is read from the same record as its entries.
+void Instance::_processSieveInterleaved(uint64_t *factorsTable, uint32_t* factorsToEliminate, const uint64_t firstPrimeIndex, const uint64_t lastPrimeIndex) {
+	const uint64_t tupleSize(_pattern.size()), stride(_factorsToEliminateStride);
 	std::array<uint32_t, sieveCacheSize> sieveCache{0};
 	uint64_t sieveCachePos(0);
-	Task checkTask{Task::Type::Check, workIndex, {}};
-	
-	if (!_works[workIndex].current) // Abort Sieve Task if new block (but count as Task done)
-		goto sieveEnd;
-	
-	memset(sieve.factorsTable, 0, sizeof(uint64_t)*_sieveWords);
-	
-	// Eliminate the p*i + fp factors (p < factorMax).
+	for (uint64_t i(firstPrimeIndex) ; i < lastPrimeIndex ; i++) {
+		uint32_t *record(&factorsToEliminate[i*stride]);
+		const uint32_t p(record[stride - 1]);
+		for (uint64_t f(0) ; f < tupleSize ; f++) {
+			while (record[f] < _sieveSize) {
+				_addToSieveCache(factorsTable, sieveCache, sieveCachePos, record[f]);
+				record[f] += p;
+			}
+			record[f] -= _sieveSize;
+		}
+	}
+	_endSieveCache(factorsTable, sieveCache);
+}
+
+#ifdef __SSE2__
+// Same, processing each record with nVectors SSE vectors. The padding and p lanes are masked.
+template <uint32_t nVectors> void Instance::_processSieveInterleavedSse(uint64_t *factorsTable, uint32_t* factorsToEliminate, const uint64_t firstPrimeIndex, const uint64_t lastPrimeIndex) {
+	assert(4*nVectors == _factorsToEliminateStride);
+	std::array<uint32_t, sieveCacheSize> sieveCache{0};
+	uint64_t sieveCachePos(0);
+	const __m128i offsetmax(_mm_set1_epi32(_sieveSize));
+	__m128i entriesMasks[nVectors];
+	for (uint32_t v(0) ; v < nVectors ; v++)
+		entriesMasks[v] = _mm_cmpgt_epi32(_mm_set1_epi32(_pattern.size()), _mm_setr_epi32(4*v, 4*v + 1, 4*v + 2, 4*v + 3));
+	for (uint64_t i(firstPrimeIndex) ; i < lastPrimeIndex ; i++) {
+		uint32_t *record(&factorsToEliminate[4*nVectors*i]);
+		const __m128i p(_mm_set1_epi32(record[4*nVectors - 1]));
+		xmmreg_t factors[nVectors];
+		for (uint32_t v(0) ; v < nVectors ; v++)
+			factors[v].m128 = _mm_load_si128(reinterpret_cast<__m128i const*>(&record[4*v]));
+		while (true) {
+			int masks(0);
+			for (uint32_t v(0) ; v < nVectors ; v++) {
+				const __m128i cmpres(_mm_and_si128(_mm_cmpgt_epi32(offsetmax, factors[v].m128), entriesMasks[v]));
+				int mask(_mm_movemask_ps(_mm_castsi128_ps(cmpres)));
+				masks |= mask;
+				while (mask != 0) {
+					_addToSieveCache(factorsTable, sieveCache, sieveCachePos, factors[v].v[__builtin_ctz(mask)]);
+					mask &= mask - 1;
+				}
+				factors[v].m128 = _mm_add_epi32(factors[v].m128, _mm_and_si128(cmpres, p));
+			}
+			if (masks == 0) break;
+		}
+		for (uint32_t v(0) ; v < nVectors ; v++)
+			_mm_store_si128(reinterpret_cast<__m128i*>(&record[4*v]), _mm_sub_epi32(factors[v].m128, _mm_and_si128(offsetmax, entriesMasks[v])));
+	}
+	_endSieveCache(factorsTable, sieveCache);
+}
+#endif
+
+void Instance::_processSievePrimesRange(uint64_t *factorsTable, uint32_t* factorsToEliminate, const uint64_t firstPrimeIndex, const uint64_t lastPrimeIndex) {
+	if (_interleavedSieveLayout) {
+#ifdef __SSE2__
+		if (_factorsToEliminateStride == 4)
+			_processSieveInterleavedSse<1>(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
+		else if (_factorsToEliminateStride == 8)
+			_processSieveInterleavedSse<2>(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
+		else if (_factorsToEliminateStride == 12)
+			_processSieveInterleavedSse<3>(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
+		else if (_factorsToEliminateStride == 16)
+			_processSieveInterleavedSse<4>(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
+		else
+#endif
+			_processSieveInterleaved(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
+		return;
+	}
 #ifdef __SSE2__
 	if (_pattern.size() == 6)
-		_processSieve6(sieve.factorsTable, sieve.factorsToEliminate, firstPrimeIndex, _primesIndexThreshold);
+		_processSieve6(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
 	else if (_pattern.size() == 7)
 #ifdef __AVX2__
-		_processSieve7_avx2(sieve.factorsTable, sieve.factorsToEliminate, firstPrimeIndex, _primesIndexThreshold);
+		_processSieve7_avx2(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
 #else
-		_processSieve7(sieve.factorsTable, sieve.factorsToEliminate, firstPrimeIndex, _primesIndexThreshold);
+		_processSieve7(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
 #endif
 	else if (_pattern.size() == 8)
 #ifdef __AVX2__
-		_processSieve8_avx2(sieve.factorsTable, sieve.factorsToEliminate, firstPrimeIndex, _primesIndexThreshold);
+		_processSieve8_avx2(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
 #else
-		_processSieve8(sieve.factorsTable, sieve.factorsToEliminate, firstPrimeIndex, _primesIndexThreshold);
+		_processSieve8(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
 #endif
 	else
-		_processSieve(sieve.factorsTable, sieve.factorsToEliminate, firstPrimeIndex, _primesIndexThreshold);
+		_processSieve(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
 #else
-	_processSieve(sieve.factorsTable, sieve.factorsToEliminate, firstPrimeIndex, _primesIndexThreshold);
+	_processSieve(factorsTable, factorsToEliminate, firstPrimeIndex, lastPrimeIndex);
+#endif
+}
+
+// Sieves with the primes of the given range by chunks, and returns false if the Work was invalidated before the end. The factorsToEliminate are then inconsistent, but they will be recomputed by the next Presieve.
+bool Instance::_processSievePrimes(const uint64_t workIndex, uint64_t *factorsTable, uint32_t* factorsToEliminate, const uint64_t firstPrimeIndex, const uint64_t lastPrimeIndex) {
+	assert((lastPrimeIndex & 1) == 0); // The chunks bounds are even, the last one must also be.
+	uint64_t chunkFirstPrimeIndex(firstPrimeIndex);
+	for (const uint64_t chunkBound : _sieveChunksBounds) {
+		if (chunkFirstPrimeIndex >= lastPrimeIndex)
+			break;
+		if (chunkBound <= chunkFirstPrimeIndex)
+			continue;
+		if (!_works[workIndex].current)
+			return false;
+		const uint64_t chunkLastPrimeIndex(std::min(chunkBound, lastPrimeIndex));
+		_processSievePrimesRange(factorsTable, factorsToEliminate, chunkFirstPrimeIndex, chunkLastPrimeIndex);
+		chunkFirstPrimeIndex = chunkLastPrimeIndex;
+	}
+	return true;
+}
+
+// Queues Tasks, and wakes up Workers if needed. Worker Tasks go to the Deque of the calling Worker (which must be one), and to the Back Queue if it is full.
+void Instance::_pushTasks(const Task* tasks, const std::size_t count, const TaskQueue queue) {
+	if (count == 0) return;
+	_nQueuedTasks += count;
+	if (queue == TaskQueue::Check)
+		_nQueuedCheckTasks += count;
+	if (queue == TaskQueue::Presieve) _presieveTasks.push_back(tasks, count);
+	else if (queue == TaskQueue::Front) {
+		for (std::size_t i(0) ; i < count ; i++) _frontTasks.push_front(tasks[i]);
+	}
+	else if (queue == TaskQueue::Back) _backTasks.push_back(tasks, count);
+	else if (queue == TaskQueue::Lookahead) _lookaheadTasks.push_back(tasks, count);
+	else if (queue == TaskQueue::Check) _checkTasks.push_back(tasks, count);
+	else {
+		assert(threadId < _threads);
+		WsDeque<Task, workerDequeCapacity> &workerTasks(*_workerTasks[threadId]);
+		std::size_t i(0);
+		while (i < count && workerTasks.push(tasks[i])) i++;
+		_backTasks.push_back(&tasks[i], count - i);
+	}
+	if (_nSleepingWorkers > 0) {
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		if (count == 1 && !_coreClassScheduling) _sleepCv.notify_one();
+		else _sleepCv.notify_all(); // With the Core Class Scheduling, a single notified Worker might not be allowed to take the Task
+	}
+}
+
+// Takes a Task following the priorities, stealing from other Workers, then working ahead as last resort. Only called by Workers.
+// With the Core Class Scheduling, the Check Tasks are in the Check Queue instead of the Deques, and the Efficiency Workers only take from there.
+bool Instance::_popTask(Task &task) {
+	if (_coreClassScheduling && _workerCoreClasses[threadId] == CoreClass::Efficiency)
+		return _popCheckTask(task);
+	bool found(_presieveTasks.try_pop_front(task) || _frontTasks.try_pop_front(task) || _workerTasks[threadId]->pop(task) || _checkTasks.try_pop_front(task) || _backTasks.try_pop_front(task));
+	for (uint16_t i(1) ; !found && i < _threads ; i++)
+		found = _workerTasks[(threadId + i) % _threads]->steal(task);
+	if (!found)
+		found = _lookaheadTasks.try_pop_front(task);
+	if (!found)
+		return false;
+	_nQueuedTasks--;
+	if (_coreClassScheduling && task.type == Task::Type::Check)
+		_nQueuedCheckTasks--;
+	return true;
+}
+
+// Takes a Check Task for an Efficiency Worker. As the Check Queue only contains Check Tasks, a failed attempt means that it is empty, so the Worker can sleep.
+bool Instance::_popCheckTask(Task &task) {
+	if (!_checkTasks.try_pop_front(task))
+		return false;
+	_nQueuedTasks--;
+	_nQueuedCheckTasks--;
+	return true;
+}
+
+// Moves the Tasks of the Jobs that are no longer ahead in the Pipeline to their normal Queues.
+void Instance::_promoteLookaheadTasks() {
+	std::vector<Task> presieveTasks, sieveTasks, lookaheadTasks;
+	Task task;
+	while (_lookaheadTasks.try_pop_front(task)) {
+		_nQueuedTasks--;
+		if (_works[task.workIndex].lookahead) lookaheadTasks.push_back(task);
+		else if (task.type == Task::Type::Presieve) presieveTasks.push_back(task);
+		else sieveTasks.push_back(task);
+	}
+	_pushTasks(presieveTasks.data(), presieveTasks.size(), TaskQueue::Presieve);
+	_pushTasks(sieveTasks.data(), sieveTasks.size(), TaskQueue::Front);
+	_pushTasks(lookaheadTasks.data(), lookaheadTasks.size(), TaskQueue::Lookahead);
+}
+
+// Blocks until a Task is available, or returns a Dummy one if the Workers must stop.
+Instance::Task Instance::_waitForTask() {
+	Task task;
+	_flushFreedCandidates(); // Give back the batched blocks, a throttled Sieve Task may be waiting for them
+	_setWorkerGeneration(UINT64_MAX); // Idle, so not on outdated Work
+	const auto idleStartTime(std::chrono::steady_clock::now());
+	while (_running) {
+		if (_popTask(task)) {
+			WorkerCounters::add(_workerCounters[threadId].idleTime, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - idleStartTime).count());
+			return task;
+		}
+		std::atomic<int64_t> &nQueuedTasks(_coreClassScheduling && _workerCoreClasses[threadId] == CoreClass::Efficiency ? _nQueuedCheckTasks : _nQueuedTasks); // The Efficiency Workers only wait for Check Tasks
+		if (nQueuedTasks > 0) // A Task is being pushed, or was taken by another Worker meanwhile
+			std::this_thread::yield();
+		else {
+			std::unique_lock<std::mutex> lock(_sleepMutex);
+			_nSleepingWorkers++;
+			_sleepCv.wait(lock, [this, &nQueuedTasks] {return nQueuedTasks > 0 || !_running;});
+			_nSleepingWorkers--;
+		}
+	}
+	return Task{Task::Type::Dummy, 0, 0, {}};
+}
+
+// Creates the Sieve Task(s) of the given iteration, one per partition. Sieve Tasks are put in front by default to finish the Sieves asap.
+// A Worker continuing a Sieve keeps the first partition for itself in its Deque and shares the others, so other Workers can process them in parallel.
+void Instance::_pushSieveTasks(const uint64_t workIndex, const uint32_t id, const uint64_t iteration, const bool front, const bool throttled) {
+	for (uint32_t partition(0) ; partition < _sievePartitions ; partition++) {
+		const Task sieveTask(Task::SieveTask(workIndex, _works[workIndex].generation, id, iteration, partition));
+		if (_works[workIndex].lookahead) {
+			_pushTasks(&sieveTask, 1, TaskQueue::Lookahead);
+			if (!_works[workIndex].lookahead) // The Job was promoted meanwhile
+				_promoteLookaheadTasks();
+		}
+		else if (throttled) _pushTasks(&sieveTask, 1, TaskQueue::Lookahead); // Only taken when there is nothing else to do, so the queued Check Tasks give back their candidates first
+		else if (!front) _pushTasks(&sieveTask, 1, TaskQueue::Back);
+		else if (threadId < _threads && partition == 0) _pushTasks(&sieveTask, 1, TaskQueue::Worker);
+		else _pushTasks(&sieveTask, 1, TaskQueue::Front);
+	}
+}
+
+#ifdef __AVX2__
+// For each byte, the positions of its bits set to 1 packed in the lowest bytes, used to expand the sieve words into candidate indexes 8 bits at once.
+static constexpr std::array<uint64_t, 256> bytePositionsTable([]() {
+	std::array<uint64_t, 256> table{};
+	for (uint32_t byte(0) ; byte < 256 ; byte++) {
+		uint32_t n(0);
+		for (uint32_t bit(0) ; bit < 8 ; bit++) {
+			if (byte & (1U << bit)) {
+				table[byte] |= static_cast<uint64_t>(bit) << (8U*n);
+				n++;
+			}
+		}
+	}
+	return table;
+}());
 #endif
+
+// Writes the indexes of the candidates (zeros in the factors table) found in the words [firstWord, lastWord) and returns their number.
+// The SIMD versions may write up to 16 garbage entries after the last candidate.
+uint32_t Instance::_extractCandidates(const uint64_t *factorsTable, const uint32_t firstWord, const uint32_t lastWord, uint32_t *candidates) {
+	uint32_t nCandidates(0);
+#if defined(__AVX512F__)
+	const __m512i firstIndexes(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)), sixteen(_mm512_set1_epi32(16));
+	for (uint32_t b(firstWord) ; b < lastWord ; b++) {
+		const uint64_t sieveWord(~factorsTable[b]); // ~ is the Bitwise Not: ones then indicate the candidates and zeros the previously eliminated numbers.
+		if (sieveWord == 0) continue;
+		__m512i indexes(_mm512_add_epi32(_mm512_set1_epi32(b*64), firstIndexes));
+		for (uint32_t i(0) ; i < 4 ; i++) { // VPCOMPRESSD packs the indexes of the ones of 16 bits of the word
+			const __mmask16 mask(sieveWord >> (16U*i));
+			_mm512_storeu_si512(reinterpret_cast<__m512i*>(&candidates[nCandidates]), _mm512_maskz_compress_epi32(mask, indexes));
+			nCandidates += __builtin_popcount(mask);
+			indexes = _mm512_add_epi32(indexes, sixteen);
+		}
+	}
+#elif defined(__AVX2__)
+	for (uint32_t b(firstWord) ; b < lastWord ; b++) {
+		const uint64_t sieveWord(~factorsTable[b]);
+		if (sieveWord == 0) continue;
+		for (uint32_t i(0) ; i < 8 ; i++) { // Look up the positions of the ones of each byte, then widen them and add the index of the byte
+			const uint8_t sieveByte(sieveWord >> (8U*i));
+			const __m256i indexes(_mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_cvtsi64_si128(bytePositionsTable[sieveByte])), _mm256_set1_epi32(b*64 + 8*i)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&candidates[nCandidates]), indexes);
+			nCandidates += __builtin_popcount(sieveByte);
+		}
+	}
+#else
+	for (uint32_t b(firstWord) ; b < lastWord ; b++) {
+		uint64_t sieveWord(~factorsTable[b]);
+		while (sieveWord != 0) {
+			candidates[nCandidates++] = (b*64) + __builtin_ctzll(sieveWord); // __builtin_ctzll returns the number of trailing 0s.
+			sieveWord &= sieveWord - 1; // Change the candidate's bit from 1 to 0.
+		}
+	}
+#endif
+	return nCandidates;
+}
+
+void Instance::_doSieveTask(Task task) {
+	Sieve& sieve(_sieve(task.workIndex, task.sieve.id));
+	const uint64_t workIndex(task.workIndex), sieveIteration(task.sieve.iteration), firstPrimeIndex(_primorialNumber), lastPrimeIndex(std::min(_primesIndexThreshold, _works[workIndex].nPrimesEffective) & ~1ULL);
+	std::array<uint32_t, sieveCacheSize> sieveCache{0};
+	uint64_t sieveCachePos(0);
+	Task checkTask{Task::Type::Check, _works[workIndex].generation, workIndex, {}};
+	thread_local std::vector<Task> checkTasks((64*extractionChunkWords + maxCandidatesPerCheckTask)/maxCandidatesPerCheckTask);
+	thread_local std::vector<uint32_t> candidatesHandles(checkTasks.size());
+	auto &candidatesPool(_works[workIndex].candidatesPool);
+	uint32_t nCandidates(0), nBlocks(0);
+	
+	if (!_works[workIndex].current) { // Abort Sieve Task if new block (but count as Task done)
+		if (_sievePartitions > 1 && sieve.nRemainingPartitions.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+		sieve.nRemainingPartitions.store(_sievePartitions, std::memory_order_relaxed);
+		goto sieveEnd;
+	}
+	
+	// Eliminate the p*i + fp factors (p < factorMax).
+	if (_sievePartitions == 1) {
+		memset(sieve.factorsTable, 0, sizeof(uint64_t)*_sieveWords);
+		if (!_processSievePrimes(workIndex, sieve.factorsTable, sieve.factorsToEliminate, firstPrimeIndex, lastPrimeIndex))
+			goto sieveEnd;
+	}
+	else { // Only eliminate for the partition's primes, and let the last partition to finish merge the tables and continue.
+		const uint32_t partition(task.sieve.partition);
+		memset(sieve.partFactorsTables[partition], 0, sizeof(uint64_t)*_sieveWords);
+		_processSievePrimes(workIndex, sieve.partFactorsTables[partition], sieve.factorsToEliminate, std::min(_sievePartitionsBounds[partition], lastPrimeIndex), std::min(_sievePartitionsBounds[partition + 1], lastPrimeIndex));
+		if (sieve.nRemainingPartitions.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return; // The Sieve Task is not done until all the partitions are.
+		sieve.nRemainingPartitions.store(_sievePartitions, std::memory_order_relaxed);
+		if (!_works[workIndex].current) // Do not merge the tables if a partition was aborted
+			goto sieveEnd;
+		for (uint32_t j(1) ; j < _sievePartitions ; j++) {
+			const uint64_t *partFactorsTable(sieve.partFactorsTables[j]);
+			for (uint64_t b(0) ; b < _sieveWords ; b++)
+				sieve.factorsTable[b] |= partFactorsTable[b];
+		}
+	}
 	
 	if (!_works[workIndex].current)
 		goto sieveEnd;
 	
 	// Wait for the presieve tasks that generate the additional factors to finish.
-	if (sieveIteration == 0) presieveLock.lock();
+	if (sieveIteration == 0 && _works[workIndex].nRemainingAdditionalPresieveTasks > 0) {
+		std::unique_lock<std::mutex> lock(_presieveMutex);
+		_presieveCv.wait(lock, [&] {return _works[workIndex].nRemainingAdditionalPresieveTasks == 0 || !_running;});
+	}
 	
 	// Eliminate these factors.
 	for (uint64_t i(0), count(sieve.additionalFactorsToEliminateCounts[sieveIteration]); i < count ; i++)
@@ -952,316 +1690,666 @@ void Instance::_doSieveTask(Task task) {
 	if (!_works[workIndex].current)
 		goto sieveEnd;
 	
-	checkTask.check.nCandidates = 0;
+	checkTask.check.nCandidates = maxCandidatesPerCheckTask;
 	checkTask.check.offsetId = sieve.id;
 	checkTask.check.factorStart = sieveIteration*_sieveSize;
-	// Extract candidates from the sieve and create verify tasks of up to maxCandidatesPerCheckTask candidates.
-	for (uint32_t b(0) ; b < _sieveWords ; b++) {
-		uint64_t sieveWord(~sieve.factorsTable[b]); // ~ is the Bitwise Not: ones then indicate the candidates and zeros the previously eliminated numbers.
-		while (sieveWord != 0) {
-			const uint32_t nEliminatedUntilNext(__builtin_ctzll(sieveWord)), candidateIndex((b*64) + nEliminatedUntilNext); // __builtin_ctzll returns the number of leading 0s.
-			checkTask.check.factorOffsets[checkTask.check.nCandidates] = candidateIndex;
-			checkTask.check.nCandidates++;
-			if (checkTask.check.nCandidates == maxCandidatesPerCheckTask) {
-				if (!_works[workIndex].current)
-					goto sieveEnd;
-				_tasks.push_back(checkTask);
-				checkTask.check.nCandidates = 0;
-				_works[workIndex].nRemainingCheckTasks++;
-			}
-			sieveWord &= sieveWord - 1; // Change the candidate's bit from 1 to 0.
+	// Extract candidates from the sieve by chunks, and create in bulk the Check Tasks of maxCandidatesPerCheckTask candidates.
+	for (uint32_t firstWord(0) ; firstWord < _sieveWords ; firstWord += extractionChunkWords) {
+		nCandidates += _extractCandidates(sieve.factorsTable, firstWord, std::min(firstWord + extractionChunkWords, static_cast<uint32_t>(_sieveWords)), &extractedCandidates[nCandidates]);
+		const uint32_t nFullCheckTasks(nCandidates/maxCandidatesPerCheckTask);
+		uint32_t nCheckTasks(nFullCheckTasks);
+		if (!candidatesPool.allocate(candidatesHandles.data(), nCheckTasks)) { // Even with the throttling, the Check Tasks are far behind (a single Sieve iteration exceeding the pool), drop the chunk rather than waiting, which could never end if this Worker has to do them
+			_droppedCandidates += nCheckTasks*maxCandidatesPerCheckTask;
+			nCheckTasks = 0;
+		}
+		for (uint32_t i(0) ; i < nCheckTasks ; i++) {
+			checkTasks[i] = checkTask;
+			checkTasks[i].check.candidates = candidatesHandles[i];
+			std::copy_n(&extractedCandidates[i*maxCandidatesPerCheckTask], maxCandidatesPerCheckTask, candidatesPool[candidatesHandles[i]].begin());
 		}
+		if (!_works[workIndex].current) // The blocks are reclaimed when the Work Slot is reused
+			goto sieveEnd;
+		nBlocks += nCheckTasks;
+		_works[workIndex].nRemainingCheckTasks += nCheckTasks;
+		_works[workIndex].candidates += nCheckTasks*maxCandidatesPerCheckTask;
+		_pushTasks(checkTasks.data(), nCheckTasks, _coreClassScheduling ? TaskQueue::Check : TaskQueue::Worker);
+		nCandidates -= nFullCheckTasks*maxCandidatesPerCheckTask;
+		std::copy_n(&extractedCandidates[nFullCheckTasks*maxCandidatesPerCheckTask], nCandidates, extractedCandidates); // Keep the remaining candidates for the next chunk
 	}
 	if (!_works[workIndex].current)
 		goto sieveEnd;
-	if (checkTask.check.nCandidates > 0) {
-		_tasks.push_back(checkTask);
-		_works[workIndex].nRemainingCheckTasks++;
+	if (nCandidates > 0) {
+		checkTask.check.nCandidates = nCandidates;
+		if (candidatesPool.allocate(&checkTask.check.candidates, 1)) {
+			std::copy_n(extractedCandidates, nCandidates, candidatesPool[checkTask.check.candidates].begin());
+			nBlocks++;
+			_works[workIndex].nRemainingCheckTasks++;
+			_works[workIndex].candidates += nCandidates;
+			_pushTasks(&checkTask, 1, _coreClassScheduling ? TaskQueue::Check : TaskQueue::Worker);
+		}
+		else _droppedCandidates += nCandidates;
 	}
 	if (sieveIteration + 1 < _sieveIterations) {
-		if (_threads > 1)
-			_tasks.push_front(Task::SieveTask(workIndex, sieve.id, sieveIteration + 1));
-		else // Allow mining with 1 Thread without having to wait for all the blocks to be processed.
-			_tasks.push_back(Task::SieveTask(workIndex, sieve.id, sieveIteration + 1));
+		const bool throttled(_backpressure.throttleSieve(candidatesPool.available(), candidatesPool.capacity(), nBlocks*_sieveWorkers)); // Leave room for the next iteration of every Sieve
+		_pushSieveTasks(workIndex, sieve.id, sieveIteration + 1, _threads > 1, throttled); // With 1 Thread, allow mining without having to wait for all the blocks to be processed.
 		return; // Sieving still not finished, do not go to sieveEnd.
 	}
 sieveEnd:
-	_tasksDoneInfos.push_back(TaskDoneInfo{Task::Type::Sieve, {}});
+	if (_works[workIndex].nRemainingSieves.fetch_sub(1) == 1)
+		_notifyMaster();
 }
 
-// Riecoin uses GMP's mpz_probab_prime_p for the PoW, but the Fermat Test is significantly faster and more suitable for the miner.
-// n is probably prime if a^(n - 1) ≡ 1 (mod n) for one 0 < a < p or more.
-static const mpz_class mpz2(2); // Here, we test with one a = 2.
-bool isPrimeFermat(const mpz_class& n) {
-	mpz_class r, nm1(n - 1);
-	mpz_powm(r.get_mpz_t(), mpz2.get_mpz_t(), nm1.get_mpz_t(), n.get_mpz_t()); // r = 2^(n - 1) % n
-	return r == 1;
+// Pushes the first Sieve Tasks of a Job, done when all the normal Presieve Tasks are finished.
+void Instance::_startSieves(const uint64_t workIndex) {
+	assert(_works[workIndex].nRemainingCheckTasks == 0);
+	_works[workIndex].nQueuedTasksMin = _queuedTasks();
+	for (uint32_t i(0) ; i < _sieveWorkers ; i++)
+		_pushSieveTasks(workIndex, i, 0, true);
+}
+
+// The Sieves can start once all the normal Presieve Tasks are done, and use the additional factors once the other ones are done too.
+void Instance::_presieveTaskDone(const Task &task) {
+	MinerWork &work(_works[task.workIndex]);
+	if (task.presieve.start < _primesIndexThreshold) {
+		if (work.nRemainingNormalPresieveTasks.fetch_sub(1) == 1)
+			_startSieves(task.workIndex);
+	}
+	else if (work.nRemainingAdditionalPresieveTasks.fetch_sub(1) == 1) {
+		std::lock_guard<std::mutex> lock(_presieveMutex);
+		_presieveCv.notify_all();
+	}
+}
+
+void Instance::_checkTaskDone(const uint64_t workIndex) {
+	MinerWork &work(_works[workIndex]);
+	if (work.nRemainingCheckTasks.fetch_sub(1) - 1 == work.checkTasksNotifyAt)
+		_notifyMaster();
+	WorkerCounters::add(_workerCounters[threadId].checkTasksDone, 1);
+	// Track how low the number of queued Tasks gets during the Sieves of each Job to adjust the Remaining Tasks Target
+	const uint32_t queuedTasks(_queuedTasks());
+	for (MinerWork &sievingWork : _works) {
+		if (sievingWork.nRemainingSieves == 0 || sievingWork.nRemainingNormalPresieveTasks > 0)
+			continue;
+		uint32_t nQueuedTasksMin(sievingWork.nQueuedTasksMin.load(std::memory_order_relaxed));
+		while (queuedTasks < nQueuedTasksMin && !sievingWork.nQueuedTasksMin.compare_exchange_weak(nQueuedTasksMin, queuedTasks, std::memory_order_relaxed));
+	}
 }
 
+void Instance::_notifyMaster() {
+	std::lock_guard<std::mutex> lock(_masterMutex);
+	_masterCv.notify_one();
+}
+
+// Tests nTests numbers of N_Size 32 bits limbs and with the same bit size with the assembly optimized Fermat Test by Michael Bell.
+// Returns false if no Kernel supports this size or the build has none, the numbers must then be tested with GMP.
 #if defined(__SSE2__) && defined(__AVX2__)
-bool Instance::_testPrimesIspc(const std::array<uint32_t, maxCandidatesPerCheckTask> &factorOffsets, uint32_t is_prime[maxCandidatesPerCheckTask], const mpz_class &candidateStart, mpz_class &candidate) { // Assembly optimized prime testing by Michael Bell
-	uint32_t M[maxCandidatesPerCheckTask*MAX_N_SIZE], bits(0), N_Size;
-	uint32_t *mp(&M[0]);
-	for (uint32_t i(0) ; i < maxCandidatesPerCheckTask ; i++) {
-		candidate = candidateStart + _primorial*factorOffsets[i];
-		if (bits == 0) {
-			bits = mpz_sizeinbase(candidate.get_mpz_t(), 2);
-			N_Size = (bits >> 5) + ((bits & 0x1f) > 0);
-			if (N_Size > MAX_N_SIZE) return false;
-		}
-		else assert(bits == mpz_sizeinbase(candidate.get_mpz_t(), 2));
-		memcpy(mp, candidate.get_mpz_t()->_mp_d, N_Size*4);
-		mp += N_Size;
-	}
-	fermatTest(N_Size, maxCandidatesPerCheckTask, M, is_prime, sysInfo.hasAVX512());
+bool Instance::_fermatTestKernel(const uint32_t N_Size, const uint64_t nTests, uint32_t *M, uint32_t *isPrime) {
+	if (sysInfo.hasAVX512IFMA()) { // The IFMA Kernel also supports the small and large sizes
+		if (N_Size < 1 || N_Size > IFMA_MAX_N_SIZE) return false;
+		fermatTestIfma(N_Size, nTests, M, isPrime);
+	}
+	else { // Limitation: without IFMA, there is no batched Kernel for the numbers above MAX_N_SIZE limbs (2048 bits), record searches then use GMP
+		if (N_Size < 6 || N_Size > MAX_N_SIZE) return false;
+		fermatTest(N_Size, nTests, M, isPrime, sysInfo.hasAVX512());
+	}
 	return true;
 }
+#else
+bool Instance::_fermatTestKernel(const uint32_t, const uint64_t, uint32_t*, uint32_t*) {return false;}
 #endif
 
+// Tests the First Numbers and then the next numbers of the pending Tuple Candidates by batches of up to 64, until there are not enough to make a batch.
+// The candidates can come from different Check Tasks (Sieve Iterations, Offsets) and be at different stages, so the batches are full even with partial Check Tasks.
+// If flush, the last batch is completed with duplicates instead of waiting for more candidates.
+void Instance::_testTupleCandidates(const bool flush, std::vector<uint64_t> &tupleCounts) {
+	uint32_t isPrime[maxCandidatesPerCheckTask];
+	std::vector<uint32_t> &M(fermatM);
+	std::vector<TupleCandidate> &candidates(tupleCandidates);
+	uint64_t &nPending(nTupleCandidates), kept(0);
+	const uint32_t workGeneration(_workGeneration);
+	// Stop testing a candidate once it cannot satisfy the requirements anymore, and submit it if it does. Returns true if the candidate is done.
+	const auto advanceCandidate([&](TupleCandidate &candidate, const bool prime) {
+		bool done(false);
+		if (candidate.patternIndex == 0) tupleCounts[0]++;
+		if (prime) {
+			candidate.primeCount++;
+			tupleCounts[candidate.primeCount]++;
+		}
+		else if (candidate.patternIndex > 0 && !_patternMin[candidate.patternIndex]) {
+			const int candidatesRemaining(_primeCountTarget - 1 - candidate.patternIndex);
+			if ((candidate.primeCount + candidatesRemaining) < _primeCountMin) done = true;
+		}
+		else done = true;
+		if (!done) {
+			candidate.patternIndex++;
+			if (candidate.patternIndex < _pattern.size()) {
+				candidate.offsetSum += _pattern[candidate.patternIndex];
+				mpz_add_ui(candidate.number.get_mpz_t(), candidate.number.get_mpz_t(), _pattern[candidate.patternIndex]);
+			}
+			else done = true;
+		}
+		if (done) {
+			if (candidate.primeCount >= _primeCountMin && candidate.generation == static_cast<uint32_t>(_workGeneration)) {
+				_addResult({
+					.jobId = candidate.jobId,
+					.threadId = threadId,
+					.result = candidate.number - candidate.offsetSum,
+					.primeCount = candidate.primeCount,
+					.primorialNumber = static_cast<uint16_t>(_primorialNumber),
+					.primorialFactor = candidate.primorialFactor,
+					.primorialOffset = _primorialOffsetsU64[candidate.offsetId]});
+			}
+		}
+		return done;
+	});
+	
+	// First Numbers, tested directly where they were built. Only the prime ones get a mpz_class and become Tuple Candidates.
+	const uint32_t firstN_Size((firstNumbersBits + 31)/32);
+	for (uint64_t j(0) ; j < nFirstNumbers ; j++) { // Discard the outdated ones
+		if (firstNumbers[j].generation == workGeneration) {
+			if (kept != j) {
+				firstNumbers[kept] = firstNumbers[j];
+				std::copy(&firstNumbersM[j*firstN_Size], &firstNumbersM[(j + 1)*firstN_Size], &firstNumbersM[kept*firstN_Size]);
+			}
+			kept++;
+		}
+	}
+	nFirstNumbers = kept;
+	while (nFirstNumbers >= fermatBatchSize || (flush && nFirstNumbers > 0)) {
+		const uint64_t nCandidates(std::min(flush ? nFirstNumbers : nFirstNumbers & ~(fermatBatchSize - 1), static_cast<uint64_t>(maxCandidatesPerCheckTask))),
+		               nTests((nCandidates + fermatBatchSize - 1) & ~(fermatBatchSize - 1)),
+		               first(nFirstNumbers - nCandidates);
+		uint32_t *firstM(&firstNumbersM[first*firstN_Size]); // _doCheckTask leaves room for the duplicates after the pending ones
+		for (uint64_t j(nCandidates) ; j < nTests ; j++)
+			std::copy(firstM, &firstM[firstN_Size], &firstM[j*firstN_Size]);
+		if (!_fermatTestKernel(firstN_Size, nTests, firstM, isPrime)) {
+			for (uint64_t j(0) ; j < nCandidates ; j++) {
+				mpz_import(importedNumber.get_mpz_t(), firstN_Size, -1, 4, 0, 0, &firstM[j*firstN_Size]);
+				isPrime[j] = isPrimeFermat(importedNumber);
+			}
+		}
+		for (uint64_t j(0) ; j < nCandidates ; j++) {
+			if (isPrime[j]) {
+				if (candidates.size() <= nPending)
+					candidates.resize(nPending + maxCandidatesPerCheckTask);
+				TupleCandidate &candidate(candidates[nPending]);
+				const FirstNumber &firstNumber(firstNumbers[first + j]);
+				candidate.generation = firstNumber.generation;
+				candidate.jobId = firstNumber.jobId;
+				candidate.offsetId = firstNumber.offsetId;
+				candidate.primorialFactor = firstNumber.primorialFactor;
+				mpz_import(candidate.number.get_mpz_t(), firstN_Size, -1, 4, 0, 0, &firstM[j*firstN_Size]);
+				candidate.patternIndex = 0;
+				candidate.primeCount = 0;
+				candidate.offsetSum = 0;
+				if (!advanceCandidate(candidate, true)) nPending++;
+			}
+			else tupleCounts[0]++;
+		}
+		nFirstNumbers = first;
+	}
+	
+	kept = 0;
+	for (uint64_t j(0) ; j < nPending ; j++) { // Discard the outdated ones, swapping the entries to not free memory
+		if (candidates[j].generation == workGeneration) {
+			if (kept != j) std::swap(candidates[kept], candidates[j]);
+			kept++;
+		}
+	}
+	nPending = kept;
+	while (nPending >= fermatBatchSize || (flush && nPending > 0)) {
+		const uint64_t nCandidates(std::min(flush ? nPending : nPending & ~(fermatBatchSize - 1), static_cast<uint64_t>(maxCandidatesPerCheckTask))),
+		               nTests((nCandidates + fermatBatchSize - 1) & ~(fermatBatchSize - 1)),
+		               first(nPending - nCandidates);
+		const uint32_t bits(mpz_sizeinbase(candidates[first].number.get_mpz_t(), 2)), N_Size((bits >> 5) + ((bits & 0x1f) > 0));
+		if (M.size() < nTests*N_Size) M.resize(nTests*N_Size);
+		for (uint64_t j(0) ; j < nTests ; j++) {
+			const mpz_class &number(j < nCandidates ? candidates[first + j].number : candidates[first].number);
+			if (mpz_sizeinbase(number.get_mpz_t(), 2) == bits)
+				mpz_export(&M[j*N_Size], nullptr, -1, 4, 0, 0, number.get_mpz_t()); // Exactly N_Size 32 bits limbs, in the native endianness
+			else // Rare case of a number with a different size in the batch, test it separately and replace it by the first one.
+				mpz_export(&M[j*N_Size], nullptr, -1, 4, 0, 0, candidates[first].number.get_mpz_t());
+		}
+		if (_fermatTestKernel(N_Size, nTests, M.data(), isPrime)) {
+			for (uint64_t j(0) ; j < nCandidates ; j++) {
+				if (mpz_sizeinbase(candidates[first + j].number.get_mpz_t(), 2) != bits)
+					isPrime[j] = isPrimeFermat(candidates[first + j].number);
+			}
+		}
+		else {
+			for (uint64_t j(0) ; j < nCandidates ; j++)
+				isPrime[j] = isPrimeFermat(candidates[first + j].number);
+		}
+		kept = first;
+		for (uint64_t j(first) ; j < first + nCandidates ; j++) {
+			if (!advanceCandidate(candidates[j], isPrime[j - first])) {
+				if (kept != j)
+					std::swap(candidates[kept], candidates[j]);
+				kept++;
+			}
+		}
+		nPending = kept;
+	}
+}
+
 void Instance::_doCheckTask(Task task) {
 	const uint16_t workIndex(task.workIndex);
-	if (!_works[workIndex].current) return;
-	std::vector<uint64_t> tupleCounts(_pattern.size() + 1, 0);
-	mpz_class candidateStart, candidate;
+	if (!_works[workIndex].current) return; // Its candidates are dropped with the others of the Work when its Slot is reused
+	// Avoid memory allocations: the thread local numbers and vectors keep their memory between Tasks.
+	// The numbers are built directly as 32 bits limbs where the Fermat Test Kernel reads them, as candidateStart + Primorial*Factor Offset, instead of making a mpz_class for each candidate and exporting it.
+	tupleCounts.assign(_pattern.size() + 1, 0);
 	mpz_mul_ui(candidateStart.get_mpz_t(), _primorial.get_mpz_t(), task.check.factorStart);
-	candidateStart += _works[workIndex].primorialMultipleStart;
-	candidateStart += _primorialOffsets[task.check.offsetId];
+	mpz_add(candidateStart.get_mpz_t(), candidateStart.get_mpz_t(), _works[workIndex].primorialMultipleStart.get_mpz_t());
+	mpz_add(candidateStart.get_mpz_t(), candidateStart.get_mpz_t(), _primorialOffsets[task.check.offsetId].get_mpz_t());
+	const uint32_t primorialN32(_primorialLimbs.size()), N32((mpz_sizeinbase(candidateStart.get_mpz_t(), 2) + 31)/32 + 2); // Room for the Primorial times a 32 bits Factor Offset
+	candidateStartLimbs.assign(N32, 0);
+	mpz_export(candidateStartLimbs.data(), nullptr, -1, 4, 0, 0, candidateStart.get_mpz_t());
+	candidateLimbs.resize(N32);
 	
-#if defined(__SSE2__) && defined(__AVX2__)
-	bool firstTestDone(false);
-	if (task.check.nCandidates == maxCandidatesPerCheckTask) { // Test candidates + 0 primality with assembly optimizations if possible.
-		uint32_t isPrime[maxCandidatesPerCheckTask];
-		firstTestDone = _testPrimesIspc(task.check.factorOffsets, isPrime, candidateStart, candidate);
-		if (firstTestDone) {
-			tupleCounts[0] += maxCandidatesPerCheckTask;
-			task.check.nCandidates = 0;
-			for (uint32_t i(0) ; i < maxCandidatesPerCheckTask ; i++) {
-				if (isPrime[i]) {
-					task.check.factorOffsets[task.check.nCandidates++] = task.check.factorOffsets[i];
-					tupleCounts[1]++;
-				}
-			}
+	if (firstNumbers.size() < nFirstNumbers + task.check.nCandidates)
+		firstNumbers.resize(nFirstNumbers + task.check.nCandidates);
+	if (firstNumbersM.size() < (nFirstNumbers + task.check.nCandidates + fermatBatchSize)*N32) // Also room for the duplicates completing a flushed batch, the numbers have at most N32 limbs
+		firstNumbersM.resize((nFirstNumbers + task.check.nCandidates + fermatBatchSize)*N32);
+	const std::array<uint32_t, maxCandidatesPerCheckTask> &factorOffsets(_works[workIndex].candidatesPool[task.check.candidates]);
+	for (uint32_t i(0) ; i < task.check.nCandidates ; i++) { // Test all the numbers later by batches
+		std::copy(candidateStartLimbs.begin(), candidateStartLimbs.end(), candidateLimbs.begin());
+		addMul32(candidateLimbs.data(), N32, _primorialLimbs.data(), primorialN32, factorOffsets[i]);
+		const uint32_t bits(bitLength32(candidateLimbs.data(), N32)), N_Size((bits + 31)/32);
+		if (bits != firstNumbersBits) { // Rare, the First Numbers must have the same size to be tested together
+			firstNumbersToTupleCandidates();
+			firstNumbersBits = bits;
 		}
+		std::copy(candidateLimbs.begin(), candidateLimbs.begin() + N_Size, &firstNumbersM[nFirstNumbers*N_Size]);
+		FirstNumber &firstNumber(firstNumbers[nFirstNumbers++]);
+		firstNumber.generation = task.generation;
+		firstNumber.jobId = _works[workIndex].job.id;
+		firstNumber.offsetId = task.check.offsetId;
+		firstNumber.primorialFactor = task.check.factorStart + factorOffsets[i];
 	}
-#endif
-	
-	for (uint32_t i(0) ; i < task.check.nCandidates ; i++) {
-		if (!_works[workIndex].current) break;
-		candidate = candidateStart + _primorial*task.check.factorOffsets[i];
-		
-#if defined(__SSE2__) && defined(__AVX2__)
-		if (!firstTestDone) { // Test candidate + 0 primality without optimizations if not done before.
-			tupleCounts[0]++;
-			if (!isPrimeFermat(candidate)) continue;
-			tupleCounts[1]++;
+	_freeCandidates(workIndex, task.check.candidates);
+	_testTupleCandidates(false, tupleCounts);
+	_updateTupleCounts(tupleCounts);
+}
+
+void Instance::_freeCandidates(const uint16_t workIndex, const uint32_t handle) {
+	const uint64_t generation(_works[workIndex].candidatesPool.generation()); // Cannot change before the Check Task is counted as done
+	if (freedCandidates.size() >= freedCandidatesBatch || workIndex != freedCandidatesWork || generation != freedCandidatesGeneration)
+		_flushFreedCandidates();
+	freedCandidatesWork = workIndex;
+	freedCandidatesGeneration = generation;
+	freedCandidates.push_back(handle);
+}
+
+void Instance::_flushFreedCandidates() {
+	if (!freedCandidates.empty())
+		_works[freedCandidatesWork].candidatesPool.free(freedCandidates.data(), freedCandidates.size(), freedCandidatesGeneration); // Ignored if the Work Slot was reused since
+	freedCandidates.clear();
+}
+
+void Instance::_updateTupleCounts(const std::vector<uint64_t> &tupleCounts) {
+	if (tupleCounts.size() != _nTupleCounts) // Do not update if Tuple Length changed meanwhile (in case of a Fork, or can be observed with the Test Server).
+		return;
+	WorkerCounters &workerCounters(_workerCounters[threadId]);
+	for (std::size_t i(0) ; i < tupleCounts.size() ; i++) {
+		if (tupleCounts[i] > 0)
+			WorkerCounters::add(workerCounters.tupleCounts[i], tupleCounts[i]);
+	}
+}
+
+uint64_t Instance::_sumCounters(std::atomic<uint64_t> WorkerCounters::*counter) const {
+	std::lock_guard<std::mutex> lock(_countersMutex);
+	uint64_t sum(_keptCounters.*counter);
+	if (_workerCounters) {
+		for (uint16_t i(0) ; i < _threads ; i++)
+			sum += _workerCounters[i].*counter;
+	}
+	return sum;
+}
+
+std::array<double, 3> Instance::getEfficiencyPhaseTimes() const {
+	std::array<double, 3> phaseTimes{0., 0., 0.};
+	std::lock_guard<std::mutex> lock(_countersMutex);
+	if (!_coreClassScheduling || !_workerCounters)
+		return phaseTimes;
+	for (uint16_t i(0) ; i < _threads ; i++) {
+		if (_workerCoreClasses[i] != CoreClass::Efficiency)
+			continue;
+		phaseTimes[0] += static_cast<double>(_workerCounters[i].presieveTime)/1e6;
+		phaseTimes[1] += static_cast<double>(_workerCounters[i].sieveTime)/1e6;
+		phaseTimes[2] += static_cast<double>(_workerCounters[i].checkTime)/1e6;
+	}
+	return phaseTimes;
+}
+
+std::vector<uint64_t> Instance::getTupleCounts() const {
+	std::lock_guard<std::mutex> lock(_countersMutex);
+	std::vector<uint64_t> tupleCounts(_nTupleCounts, 0ULL);
+	for (std::size_t i(0) ; i < tupleCounts.size() ; i++) {
+		tupleCounts[i] = _keptCounters.tupleCounts[i];
+		if (_workerCounters) {
+			for (uint16_t j(0) ; j < _threads ; j++)
+				tupleCounts[i] += _workerCounters[j].tupleCounts[i];
 		}
-#else
-		tupleCounts[0]++;
-		if (!isPrimeFermat(candidate)) continue;
-		tupleCounts[1]++;
+	}
+	return tupleCounts;
+}
+
+// Riecoin's PoW uses mpz_probab_prime_p, which can reject a base 2 Fermat pseudoprime. Results are verified with it here, in a lower priority thread not delaying the Workers, before being given to the Client.
+constexpr int consensusPrimalityReps(32);
+void Instance::_verifyResults() {
+#if defined(__linux__)
+	setpriority(PRIO_PROCESS, 0, 5); // On Linux, the nice value is per thread. Not the lowest priority, as the latency matters for the Pool Shares
+#elif defined(_WIN32)
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
 #endif
-		
-		uint32_t primeCount(1), offsetSum(0);
-		// Test primality of the other elements of the tuple if candidate + 0 is prime.
-		for (std::vector<uint64_t>::size_type i(1) ; i < _pattern.size() ; i++) {
-			offsetSum += _pattern[i];
-			mpz_add_ui(candidate.get_mpz_t(), candidate.get_mpz_t(), _pattern[i]);
-			if (isPrimeFermat(mpz_class(candidate))) {
+	mpz_class n;
+	while (true) {
+		ResultToVerify resultToVerify(_resultsToVerify.blocking_pop_front());
+		if (resultToVerify.stop) break;
+		Result &result(resultToVerify.result);
+		// Count the primes like when testing the Tuple Candidates, but with the consensus test
+		uint32_t primeCount(0);
+		n = result.result;
+		for (uint64_t i(0) ; i < _pattern.size() ; i++) {
+			if (i > 0) n += _pattern[i];
+			if (mpz_probab_prime_p(n.get_mpz_t(), consensusPrimalityReps) != 0)
 				primeCount++;
-				tupleCounts[primeCount]++;
+			else {
+				if (isPrimeFermat(n)) _pseudoprimes++;
+				if (i == 0 || _patternMin[i] || primeCount + (_primeCountTarget - 1 - i) < _primeCountMin) break;
 			}
-			else if (!_patternMin[i]) {
-				int candidatesRemaining(_primeCountTarget - 1 - i);
-				if ((primeCount + candidatesRemaining) < _primeCountMin) break; // No chance to met the requirement anymore.
-			}
-			else break;
 		}
-		// Submit if requirements satisfied (and Job still valid).
-		if (_works[_currentWorkIndex].current && primeCount >= _primeCountMin) {
-			std::string message;
-			const mpz_class basePrime(candidate - offsetSum);
-			_addResult({
-				.jobId = _works[workIndex].job.id,
-				.threadId = threadId,
-				.result = basePrime,
-				.primeCount = primeCount,
-				.primorialNumber = static_cast<uint16_t>(_primorialNumber),
-				.primorialFactor = task.check.factorStart + task.check.factorOffsets[i],
-				.primorialOffset = _primorialOffsetsU64[task.check.offsetId]});
+		const uint64_t latency(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - resultToVerify.foundTp).count());
+		_resultsVerified++;
+		_verificationLatencyTotal += latency;
+		if (latency > _verificationLatencyMax) _verificationLatencyMax = latency;
+		if (primeCount >= _primeCountMin) {
+			result.primeCount = primeCount;
+			std::lock_guard<std::mutex> lock(_resultMutex);
+			_results.push_back(result);
 		}
+		else _resultsDiscarded++;
 	}
-	std::lock_guard<std::mutex> lock(_countsLock);
-	if (_tupleCounts.size() == tupleCounts.size()) // Do not update if Tuple Length changed meanwhile (in case of a Fork, or can be observed with the Test Server).
-		std::transform(_tupleCounts.begin(), _tupleCounts.end(), tupleCounts.begin(), _tupleCounts.begin(), std::plus<uint64_t>());
 }
 
 void Instance::_doTasks(const uint16_t id) { // Worker Threads run here until the miner is stopped
 	// Thread initialization.
 	threadId = id;
-	factorsCache = new uint64_t*[_sieveWorkers];
-	factorsCacheCounts = new uint64_t*[_sieveWorkers];
+#if defined(__linux__)
+	if (_workerCpus[id] >= 0) { // Fails harmlessly if the CPU does not exist, e. g. with a Core Classes map not matching the machine
+		if (!unpinnedCpuSet.has_value()) {
+			cpu_set_t cpuSet;
+			if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0)
+				unpinnedCpuSet = cpuSet;
+		}
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(_workerCpus[id], &cpuSet);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+	}
+	else if (unpinnedCpuSet.has_value()) {
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &unpinnedCpuSet.value());
+		unpinnedCpuSet.reset();
+	}
+#endif
+	if (factorsCacheSieves < _sieveWorkers || factorsCacheIterations < _sieveIterations) {
+		for (int i(0) ; i < factorsCacheSieves ; i++) {
+			delete[] factorsCacheCounts[i];
+			delete[] factorsCache[i];
+		}
+		delete[] factorsCacheCounts;
+		delete[] factorsCache;
+		factorsCacheSieves = std::max(factorsCacheSieves, _sieveWorkers);
+		factorsCacheIterations = std::max(factorsCacheIterations, _sieveIterations);
+		factorsCache = new uint64_t*[factorsCacheSieves];
+		factorsCacheCounts = new uint64_t*[factorsCacheSieves];
+		for (int i(0) ; i < factorsCacheSieves ; i++) {
+			factorsCache[i] = new uint64_t[factorsCacheSize];
+			factorsCacheCounts[i] = new uint64_t[factorsCacheIterations];
+		}
+	}
 	for (int i(0) ; i < _sieveWorkers ; i++) {
-		factorsCache[i] = new uint64_t[factorsCacheSize];
-		factorsCacheCounts[i] = new uint64_t[_sieveIterations];
 		for (uint64_t j(0) ; j < _sieveIterations ; j++)
 			factorsCacheCounts[i][j] = 0;
 	}
+	if (extractedCandidates == nullptr)
+		extractedCandidates = new uint32_t[64*extractionChunkWords + maxCandidatesPerCheckTask + 16];
 	// Threads are fetching tasks from the queues. The first part of the constellation search is sieving to generate candidates, which is done by the Presieve and Sieve tasks.
 	// Once the candidates were generated, they are tested whether they are indeed base primes of constellations using the Fermat Test.
 	while (_running) {
 		Task task;
-		if (!_presieveTasks.try_pop_front(task)) // Presieve Tasks have priority
-			task = _tasks.blocking_pop_front();
+		if ((nFirstNumbers > 0 || nTupleCandidates > 0) && _nQueuedTasks == 0) { // Do not let the pending Tuple Candidates wait if there is nothing else to do
+			const auto startTime(std::chrono::steady_clock::now());
+			tupleCounts.assign(_pattern.size() + 1, 0);
+			_testTupleCandidates(true, tupleCounts);
+			_updateTupleCounts(tupleCounts);
+			WorkerCounters::add(_workerCounters[threadId].checkTime, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count());
+		}
+		if (!_popTask(task))
+			task = _waitForTask();
+		_setWorkerGeneration(task.type == Task::Type::Dummy ? UINT64_MAX : task.generation);
 		
 		const auto startTime(std::chrono::steady_clock::now());
+		const auto addTaskTime([&](std::atomic<uint64_t> WorkerCounters::*counter, const std::size_t phase) { // To the Worker's totals and to the Job's own
+			const uint64_t duration(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count());
+			WorkerCounters::add(_workerCounters[threadId].*counter, duration);
+			_works[task.workIndex].phaseTimes[phase].fetch_add(duration, std::memory_order_relaxed);
+		});
 		if (task.type == Task::Type::Presieve) {
 			_doPresieveTask(task);
-			_presieveTime += std::chrono::duration_cast<decltype(_presieveTime)>(std::chrono::steady_clock::now() - startTime);
-			_tasksDoneInfos.push_back(TaskDoneInfo{Task::Type::Presieve, {task.presieve.start}});
+			addTaskTime(&WorkerCounters::presieveTime, 0);
+			_presieveTaskDone(task);
 		}
 		if (task.type == Task::Type::Sieve) {
 			_doSieveTask(task);
-			_sieveTime += std::chrono::duration_cast<decltype(_sieveTime)>(std::chrono::steady_clock::now() - startTime);
-			// The Sieve's Task Done Info is created in _doSieveTask
+			addTaskTime(&WorkerCounters::sieveTime, 1);
+			// The Sieve's completion is counted in _doSieveTask, as a Sieve is done only after its last iteration
 		}
 		if (task.type == Task::Type::Check) {
 			_doCheckTask(task);
-			_verifyTime += std::chrono::duration_cast<decltype(_verifyTime)>(std::chrono::steady_clock::now() - startTime);
-			_tasksDoneInfos.push_back(TaskDoneInfo{Task::Type::Check, {task.workIndex}});
+			addTaskTime(&WorkerCounters::checkTime, 2);
+			_checkTaskDone(task.workIndex);
 		}
 	}
-	// Thread clean up.
-	for (int i(0) ; i < _sieveWorkers ; i++) {
-		delete[] factorsCacheCounts[i];
-		delete[] factorsCache[i];
-	}
-	delete[] factorsCacheCounts;
-	delete[] factorsCache;
+	// Detach from the Instance, the memory is kept for the next one.
+	_flushFreedCandidates();
+	nFirstNumbers = 0;
+	nTupleCandidates = 0;
 }
 
 void Instance::invalidateWork() {
+	bool wasCurrent(false);
 	for (auto &work : _works)
-		work.current = false;
+		wasCurrent |= work.current.exchange(false);
+	if (wasCurrent) {
+		const bool measureWorkSwitch(_running); // Measure how long the Workers take to leave the outdated Work
+		if (measureWorkSwitch)
+			_workSwitchStart = std::chrono::steady_clock::now().time_since_epoch().count();
+		_workGeneration++; // Also makes the pending Tuple Candidates outdated
+		if (measureWorkSwitch) {
+			_workSwitchPending = true;
+			_checkWorkSwitch();
+		}
+	}
+}
+
+void Instance::_setWorkerGeneration(const uint64_t generation) {
+	_workerGenerations[threadId].generation = generation;
+	if (_workSwitchPending)
+		_checkWorkSwitch();
+}
+
+// Records the Work Switch Latency once all the Workers are idle or on a Task taken after the last invalidation.
+void Instance::_checkWorkSwitch() {
+	const uint64_t workGeneration(_workGeneration);
+	for (uint16_t i(0) ; i < _threads ; i++) {
+		if (_workerGenerations[i].generation < workGeneration)
+			return;
+	}
+	bool pending(true);
+	if (_workSwitchPending.compare_exchange_strong(pending, false)) {
+		const uint64_t latency(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(_workSwitchStart))).count());
+		_workSwitchLatencies[latency == 0 ? 0 : std::min<uint64_t>(64 - __builtin_clzll(latency), workSwitchLatencyBuckets - 1)]++;
+	}
+}
+
+// Estimates from the timings of a fully processed Job whether sieving with a bit more or less primes would reduce the total cost, and adjusts the number of primes used for the next Jobs accordingly.
+// Sieving with the primes of a range costs presieving them and, for p < factorMax, a share of the sieving time proportional to the sum of 1 + sieveSize/p. In return, the candidates survive with a probability of about (ln(pFirst)/ln(pLast))^k (Mertens' Theorem), the others saving their Fermat Tests.
+void Instance::_adjustSieveDepth(const MinerWork &work) {
+	const uint64_t nPrimesEffective(work.nPrimesEffective), nPrimesMin(std::max(_primorialNumber + 2ULL, _nPrimes/16ULL) & ~1ULL);
+	const uint64_t candidates(work.candidates), presieveTime(work.phaseTimes[0]), sieveTime(work.phaseTimes[1]), checkTime(work.phaseTimes[2]);
+	if (nPrimesEffective != _nPrimesEffective) // The Depth was already adjusted since this Job started, by an older one that was in the Pipeline with it
+		return;
+	if (candidates == 0 || checkTime == 0 || presieveTime == 0 || nPrimesEffective <= _primorialNumber)
+		return;
+	const auto sieveWeight([this](const uint64_t first, const uint64_t end) {
+		const uint64_t last(std::min(end, _primesIndexThreshold));
+		if (first >= last) return 0.;
+		return static_cast<double>(last - first) + static_cast<double>(_sieveSize)*(std::log(std::log(static_cast<double>(_getPrime(last - 1)))) - std::log(std::log(static_cast<double>(_getPrime(first)))));
+	});
+	const double fermatCost(static_cast<double>(checkTime)/static_cast<double>(candidates)),
+	             presieveCost(static_cast<double>(presieveTime)/static_cast<double>(nPrimesEffective - _primorialNumber)),
+	             sieveCostPerWeight(static_cast<double>(sieveTime)/std::max(sieveWeight(_primorialNumber, nPrimesEffective), 1.));
+	const auto rangeCost([&](const uint64_t first, const uint64_t end) {return static_cast<double>(end - first)*presieveCost + sieveWeight(first, end)*sieveCostPerWeight;});
+	const auto survivalProbability([this](const uint64_t first, const uint64_t end) {return std::pow(std::log(static_cast<double>(_getPrime(first)))/std::log(static_cast<double>(_getPrime(end - 1))), static_cast<double>(_pattern.size()));});
+	const uint64_t step(std::max((nPrimesEffective/32ULL) & ~1ULL, 2ULL));
+	if (nPrimesEffective < (_nPrimes & ~1ULL)) { // Sieving deeper would eliminate enough candidates?
+		const uint64_t end(std::min<uint64_t>(nPrimesEffective + step, _nPrimes & ~1ULL));
+		if (static_cast<double>(candidates)*(1. - survivalProbability(nPrimesEffective, end))*fermatCost > rangeCost(nPrimesEffective, end)) {
+			_nPrimesEffective = end;
+			return;
+		}
+	}
+	if (nPrimesEffective >= nPrimesMin + step) { // Sieving less deep would not add too many candidates?
+		const uint64_t first((nPrimesEffective - step) & ~1ULL);
+		if (static_cast<double>(candidates)*(1./survivalProbability(first, nPrimesEffective) - 1.)*fermatCost < rangeCost(first, nPrimesEffective))
+			_nPrimesEffective = first;
+	}
+}
+
+void BackpressureController::update(const bool measurable, const uint32_t remainingTasks, const uint32_t queuedTasksMin, const double checkTaskRate) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (checkTaskRate > 0.) {
+		_stats.checkTaskRate = _stats.checkTaskRate > 0. ? 0.75*_stats.checkTaskRate + 0.25*checkTaskRate : checkTaskRate;
+		_stats.targetMax = std::max(static_cast<uint32_t>(_stats.checkTaskRate*_maxStaleTime), _stats.targetMin);
+	}
+	_stats.lastRemainingTasks = remainingTasks;
+	_stats.lastQueuedTasksMin = queuedTasksMin;
+	const bool targetReached(remainingTasks + 2U*_threads >= _stats.target); // Else, the Sieves did not produce enough Check Tasks
+	if (!measurable) // The Job was interrupted
+		_stats.lastDecision = BackpressureStats::Skip;
+	else if (queuedTasksMin == 0 && targetReached) { // The Workers ran out of Tasks, but by how much is unknown, so increase the Target significantly
+		_stats.lastDecision = BackpressureStats::Increase;
+		_stats.target += _stats.target/2U + 4U*_threads;
+	}
+	else if (queuedTasksMin < _stats.targetMin && !targetReached) // More Sieve Workers would be needed, changing the Target would not help
+		_stats.lastDecision = BackpressureStats::Saturated;
+	else { // The lowest queue length moves by as much as the Tasks that were queued at the start, go halfway towards the value giving the desired minimum
+		_stats.lastDecision = BackpressureStats::Adjust;
+		const int64_t targetIdeal(static_cast<int64_t>(std::min(remainingTasks, _stats.target)) + static_cast<int64_t>(_stats.targetMin) - static_cast<int64_t>(queuedTasksMin));
+		_stats.target = std::max((static_cast<int64_t>(_stats.target) + targetIdeal)/2, static_cast<int64_t>(0));
+	}
+	_stats.target = std::clamp(_stats.target, _stats.targetMin, _stats.targetMax);
+	_stats.decisions[_stats.lastDecision]++;
 }
 
 void Instance::_manageTasks() {
 	Stella::Job job;
 	_currentWorkIndex = 0;
+	uint64_t nJobsStarted(0);
+	std::deque<uint32_t> pipelinedWorks; // Work Slots of the Jobs that may still be presieving or sieving, oldest first
+	const auto waitForCheckTasks([this](MinerWork &waitedWork, const uint64_t n) { // Until at most n remain
+		waitedWork.checkTasksNotifyAt = n;
+		std::unique_lock<std::mutex> lock(_masterMutex);
+		_masterCv.wait(lock, [&] {return waitedWork.nRemainingCheckTasks <= n || !_running;});
+		waitedWork.checkTasksNotifyAt = UINT64_MAX;
+	});
+	auto jobWaitStartTime(std::chrono::steady_clock::now()), lastRetirementTime(std::chrono::steady_clock::now());
+	uint64_t checkTasksDoneAtLastRetirement(0);
 	while (_running) {
-		// Pop next Job, wait if there is none.
-		if (!_availableJobs.try_pop_front(job)) {
-			std::this_thread::sleep_for(2ms);
+		// Pop next Job, wait if there is none, and ask for more if the prefetched ones run low.
+		if (!_availableJobs.pop_front_for(job, 10ms))
 			continue;
+		if (needsJobs()) {
+			std::lock_guard<std::mutex> lock(_jobRequestMutex);
+			_jobRequested = true;
+			_jobRequestCv.notify_one();
 		}
+		_jobWaitTimeTotal += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - jobWaitStartTime).count();
+		_jobsStarted++;
 		
-		_works[_currentWorkIndex].job = job;
+		MinerWork &work(_works[_currentWorkIndex]);
+		work.job = job;
 		if (job.clearPreviousJobs)
 			invalidateWork();
-		_works[_currentWorkIndex].current = true;
-		_works[_currentWorkIndex].primorialMultipleStart = _works[_currentWorkIndex].job.target + _primorial - (_works[_currentWorkIndex].job.target % _primorial);
+		work.generation = _workGeneration; // Before setting it current, so an invalidation done meanwhile makes it outdated
+		work.current = true;
+		work.primorialMultipleStart = work.job.target + _primorial - (work.job.target % _primorial);
+		work.sieveSet = nJobsStarted % _pipelineDepth; // The Jobs that used this set before were retired from the Pipeline, so their Sieves are finished
+		work.nPrimesEffective = _nPrimesEffective;
+		work.nQueuedTasksMin = UINT32_MAX;
+		for (auto &phaseTime : work.phaseTimes) phaseTime = 0;
+		work.candidates = 0;
+		nJobsStarted++;
 		
-		// Reset Stats and Sieve State.
-		_presieveTime = _presieveTime.zero();
-		_sieveTime = _sieveTime.zero();
-		_verifyTime = _verifyTime.zero();
-		for (auto &sieve : _sieves) {
+		// Reset Sieve State.
+		for (uint32_t i(0) ; i < _sieveWorkers ; i++) {
 			for (uint64_t j(0) ; j < _sieveIterations ; j++)
-				sieve.additionalFactorsToEliminateCounts[j] = 0;
+				_sieve(_currentWorkIndex, i).additionalFactorsToEliminateCounts[j] = 0;
 		}
-		// Create Presieve Tasks.
+		// Create Presieve Tasks. The Workers then start the Sieves once they are done.
 		uint64_t nPresieveTasks(_threads*8ULL);
-		int32_t nRemainingNormalPresieveTasks(0), nRemainingAdditionalPresieveTasks(0);
-		const uint32_t remainingTasks(_tasks.size());
-		const uint64_t primesPerPresieveTask((_nPrimes - _primorialNumber)/nPresieveTasks + 1ULL);
-		for (uint64_t start(_primorialNumber) ; start < _nPrimes ; start += primesPerPresieveTask) {
-			const uint64_t end(std::min(_nPrimes, start + primesPerPresieveTask));
-			_presieveTasks.push_back(Task::PresieveTask(_currentWorkIndex, start, end));
-			_tasks.push_front(Task{Task::Type::Dummy, _currentWorkIndex, {}}); // Ensure a thread wakes up to grab the mod work.
-			if (start < _primesIndexThreshold) nRemainingNormalPresieveTasks++;
-			else nRemainingAdditionalPresieveTasks++;
-		}
-		
-		// Sieve Tasks cannot be started until all Presieve Tasks are finished.
-		while (nRemainingNormalPresieveTasks > 0) {
-			const TaskDoneInfo taskDoneInfo(_tasksDoneInfos.blocking_pop_front());
-			if (!_running) return; // Can happen if stopThreads is called while this Thread is stuck in this blocking_pop_front().
-			if (taskDoneInfo.type == Task::Type::Presieve) {
-				if (taskDoneInfo.firstPrimeIndex < _primesIndexThreshold) nRemainingNormalPresieveTasks--;
-				else nRemainingAdditionalPresieveTasks--;
-			}
-			else if (taskDoneInfo.type == Task::Type::Check) _works[taskDoneInfo.workIndex].nRemainingCheckTasks--;
-			else assert(false); // Unexpected Sieve Task done during Presieving. Should never happen but useful for debugging if trying to improve the Job Management.
+		int32_t nNormalPresieveTasks(0), nAdditionalPresieveTasks(0);
+		work.queuedTasksAtStart = _queuedTasks();
+		const uint64_t nPrimesEffective(work.nPrimesEffective), primesPerPresieveTask((nPrimesEffective - _primorialNumber)/nPresieveTasks + 1ULL);
+		std::vector<Task> presieveTasks;
+		for (uint64_t start(_primorialNumber) ; start < nPrimesEffective ; start += primesPerPresieveTask) {
+			const uint64_t end(std::min(nPrimesEffective, start + primesPerPresieveTask));
+			presieveTasks.push_back(Task::PresieveTask(_currentWorkIndex, work.generation, start, end));
+			if (start < _primesIndexThreshold) nNormalPresieveTasks++;
+			else nAdditionalPresieveTasks++;
 		}
-		assert(_works[_currentWorkIndex].nRemainingCheckTasks == 0);
+		work.nRemainingNormalPresieveTasks = nNormalPresieveTasks;
+		work.nRemainingAdditionalPresieveTasks = nAdditionalPresieveTasks;
+		work.nRemainingSieves = _sieveWorkers;
+		work.lookahead = !pipelinedWorks.empty();
+		_pushTasks(presieveTasks.data(), presieveTasks.size(), work.lookahead ? TaskQueue::Lookahead : TaskQueue::Presieve);
+		if (nNormalPresieveTasks == 0)
+			_startSieves(_currentWorkIndex);
+		pipelinedWorks.push_back(_currentWorkIndex);
 		
-		// Create Sieve Tasks
-		for (std::vector<Sieve>::size_type i(0) ; i < _sieves.size() ; i++) {
-			_sieves[i].presieveLock.lock();
-			_tasks.push_front(Task::SieveTask(_currentWorkIndex, i, 0));
-		}
-		
-		int nRemainingSieves(_sieveWorkers);
-		while (nRemainingAdditionalPresieveTasks > 0) {
-			const TaskDoneInfo taskDoneInfo(_tasksDoneInfos.blocking_pop_front());
-			if (!_running) {
-				for (auto &sieve : _sieves) sieve.presieveLock.unlock();
-				return;
+		// If the Pipeline is not full, take the next Job right away, so it is presieved while this one is sieving. Else, retire the oldest Job once its Sieves are finished.
+		if (pipelinedWorks.size() >= _pipelineDepth) {
+			MinerWork &oldestWork(_works[pipelinedWorks.front()]);
+			pipelinedWorks.pop_front();
+			{
+				std::unique_lock<std::mutex> lock(_masterMutex);
+				_masterCv.wait(lock, [&] {return oldestWork.nRemainingSieves == 0 || !_running;});
 			}
-			if (taskDoneInfo.type == Task::Type::Presieve) nRemainingAdditionalPresieveTasks--;
-			else if (taskDoneInfo.type == Task::Type::Sieve) nRemainingSieves--;
-			else _works[taskDoneInfo.workIndex].nRemainingCheckTasks--;
-		}
-		for (auto &sieve : _sieves) sieve.presieveLock.unlock();
-		
-		// Measure how low the number of pending Tasks have been and later adjust the Remaining Tasks Target in function of this.
-		uint32_t nRemainingTasksMin(std::min(remainingTasks, _tasks.size()));
-		while (nRemainingSieves > 0) {
-			const TaskDoneInfo taskDoneInfo(_tasksDoneInfos.blocking_pop_front());
 			if (!_running) return;
-			if (taskDoneInfo.type == Task::Type::Sieve) nRemainingSieves--;
-			else if (taskDoneInfo.type == Task::Type::Check) _works[taskDoneInfo.workIndex].nRemainingCheckTasks--;
-			else assert(false); // Unexpected Presieve Task done during Sieving. Should never happen but useful for debugging if trying to improve the Job Management.
-			nRemainingTasksMin = std::min(nRemainingTasksMin, _tasks.size());
-		}
-		
-		// Adjust the Remaining Tasks Target.
-		if (_works[_currentWorkIndex].current && !job.clearPreviousJobs) {
-			// std::cout << "Min work outstanding during sieving: "s << nRemainingTasksMin << "\n"s;
-			if (remainingTasks > _nRemainingCheckTasksTarget - _threads*2) {
-				// If we are acheiving our work target, then adjust it towards the amount required to maintain a healthy minimum work queue length.
-				if (nRemainingTasksMin == 0) // Need more, but don't know how much, try adding some.
-					_nRemainingCheckTasksTarget += 4*_threads*_sieveWorkers;
-				else { // Adjust towards target of min work = 4*threads.
-					const uint32_t targetMaxWork((_nRemainingCheckTasksTarget - nRemainingTasksMin) + 8*_threads);
-					_nRemainingCheckTasksTarget = (_nRemainingCheckTasksTarget + targetMaxWork)/2;
-				}
-			}
-			else if (nRemainingTasksMin > 4u*_threads) { // Didn't make the target, but also didn't run out of work. Can still adjust target.
-				const uint32_t targetMaxWork((remainingTasks - nRemainingTasksMin) + 10*_threads);
-				_nRemainingCheckTasksTarget = (_nRemainingCheckTasksTarget + targetMaxWork)/2;
+			if (!pipelinedWorks.empty()) {
+				_works[pipelinedWorks.front()].lookahead = false; // The next Job is now the oldest one, give it the normal priority
+				_promoteLookaheadTasks();
 			}
-			// Else not enough Check Tasks are produced and the CPU is possibly going to be underused. User can alleviate this by increasing the SieveWorkers, but no adjustment of the Target here would help. The Job management needs to be improved as a whole to fix the underlying issue for good.
-			_nRemainingCheckTasksTarget = std::min(_nRemainingCheckTasksTarget, _tasksDoneInfos.size() - 9*_threads);
-			// std::cout << "Work target before starting next block now: "s << _nRemainingCheckTasksTarget << "\n"s;
-		}
-		
-		// Remove surplus Check Tasks in accordance with the Target.
-		while (_works[_currentWorkIndex].nRemainingCheckTasks > _nRemainingCheckTasksTarget) {
-			const TaskDoneInfo taskDoneInfo(_tasksDoneInfos.blocking_pop_front());
-			if (!_running) return;
-			if (taskDoneInfo.type == Task::Type::Check) _works[taskDoneInfo.workIndex].nRemainingCheckTasks--;
-			else assert(false); // Only Check Tasks are expected here. Should never happen but useful for debugging if trying to improve the Job Management.
-		}
-		
-		// Before starting next Job, ensure that any Check Tasks left of its work slot are finished.
-		_currentWorkIndex = (_currentWorkIndex + 1) % nWorks;
-		while (_works[_currentWorkIndex].nRemainingCheckTasks > 0) {
-			const TaskDoneInfo taskDoneInfo(_tasksDoneInfos.blocking_pop_front());
-			if (!_running) return;
-			if (taskDoneInfo.type == Task::Type::Check) _works[taskDoneInfo.workIndex].nRemainingCheckTasks--;
-			else assert(false); // Only Check Tasks are expected here. Should never happen but useful for debugging if trying to improve the Job Management.
+			// Give to the Backpressure Controller how low the number of queued Tasks has been during the Sieves of this Job, and the Check Task Rate.
+			const uint32_t remainingTasks(oldestWork.queuedTasksAtStart), nQueuedTasksMin(std::min(remainingTasks, oldestWork.nQueuedTasksMin.load()));
+			const uint64_t checkTasksDone(_sumCounters(&WorkerCounters::checkTasksDone));
+			const double retirementInterval(timeSince(lastRetirementTime));
+			_backpressure.update(oldestWork.current && !oldestWork.job.clearPreviousJobs, remainingTasks, nQueuedTasksMin, retirementInterval > 0. ? static_cast<double>(checkTasksDone - checkTasksDoneAtLastRetirement)/retirementInterval : 0.);
+			lastRetirementTime = std::chrono::steady_clock::now();
+			checkTasksDoneAtLastRetirement = checkTasksDone;
+			
+			// Remove surplus Check Tasks in accordance with the Target.
+			waitForCheckTasks(oldestWork, _backpressure.target());
 		}
-		// std::cout << "Job Timing: "s << _presieveTime.count() << "/"s << _sieveTime.count() << "/"s << _verifyTime.count() << ", tasks: "s << _works[0].nRemainingCheckTasks << ", "s << _works[1].nRemainingCheckTasks << "\n"s;
+		// Before starting the next Job, ensure that any Check Tasks left of its Work Slot are finished. The Job that used it is then fully processed, and if it was not interrupted, its timings can be used to adjust the Sieve Depth.
+		_currentWorkIndex = (_currentWorkIndex + 1) % _works.size();
+		waitForCheckTasks(_works[_currentWorkIndex], 0);
+		if (!_running) return;
+		if (_adaptiveSieveDepth && _works[_currentWorkIndex].current)
+			_adjustSieveDepth(_works[_currentWorkIndex]);
+		_works[_currentWorkIndex].candidatesPool.reset(); // Also drops the candidates of the Check Tasks aborted after an invalidation
+		jobWaitStartTime = std::chrono::steady_clock::now();
 	}
 }
 
@@ -1300,6 +2388,31 @@ std::string formattedCounts(const std::vector<uint64_t> &counts, const uint64_t
 	return oss.str();
 }
 
+std::string formattedWorkSwitchLatencies(const WorkSwitchLatencies &workSwitchLatencies) {
+	std::ostringstream oss;
+	for (std::size_t i(0) ; i < workSwitchLatencyBuckets ; i++) {
+		if (i == 0) oss << "< 1 ms: ";
+		else if (i + 1 == workSwitchLatencyBuckets) oss << ">= " << (1ULL << (i - 1)) << " ms: ";
+		else oss << (1ULL << (i - 1)) << "-" << (1ULL << i) << " ms: ";
+		oss << workSwitchLatencies[i];
+		if (i + 1 != workSwitchLatencyBuckets) oss << ", ";
+	}
+	return oss.str();
+}
+
+std::string formattedBackpressureStats(const BackpressureStats &backpressureStats) {
+	std::ostringstream oss;
+	oss << "Target " << backpressureStats.target << " (" << backpressureStats.targetMin << "-" << backpressureStats.targetMax << "), last Job: " << backpressureStats.lastRemainingTasks << " remaining, lowest queue " << backpressureStats.lastQueuedTasksMin;
+	oss << ", " << FIXED(1) << backpressureStats.checkTaskRate << " Check Tasks/s, decisions: ";
+	oss << backpressureStats.decisions[BackpressureStats::Increase] << " increase(s), " << backpressureStats.decisions[BackpressureStats::Adjust] << " adjustment(s), ";
+	oss << backpressureStats.decisions[BackpressureStats::Saturated] << " saturated, " << backpressureStats.decisions[BackpressureStats::Skip] << " skipped";
+	if (backpressureStats.throttledSieves > 0)
+		oss << ", " << backpressureStats.throttledSieves << " Sieve Task(s) throttled as the candidates memory was running out";
+	if (backpressureStats.droppedCandidates > 0)
+		oss << ", " << backpressureStats.droppedCandidates << " candidates dropped as the Check Tasks were too far behind";
+	return oss.str();
+}
+
 std::string formattedTime(const double &time) {
 	std::ostringstream oss;
 	const uint32_t timeInt(time*1000.);
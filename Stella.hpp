@@ -3,6 +3,7 @@
 #ifndef HEADER_Stella_hpp
 #define HEADER_Stella_hpp
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cassert>
@@ -10,11 +11,13 @@
 #include <condition_variable>
 #include <deque>
 #include <fstream>
+#include <functional>
 #include <gmpxx.h>
 #include <iomanip>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <numeric>
 #include <optional>
 #include <sstream>
@@ -37,19 +40,32 @@ using namespace std::string_literals;
 #define primeTableFile	"PrimeTable64.bin"
 
 namespace Stella {
+// Performance and Efficiency Cores of hybrid CPUs.
+enum class CoreClass : uint8_t {Performance, Efficiency};
+
 class SysInfo {
 	std::string _os, _cpuArchitecture, _cpuBrand;
 	uint64_t _physicalMemory;
-	bool _avx, _avx2, _avx512;
+	uint64_t _l1DataCacheSize, _l2CacheSize, _l3CacheSize; // In bytes, 0 if unknown
+	uint16_t _l2SharingThreads, _l3SharingThreads; // How many logical CPUs share an instance of the cache
+	bool _avx, _avx2, _avx512, _avx512Ifma;
+	std::vector<CoreClass> _coreClasses; // Class of each logical CPU, empty if the CPU is not hybrid or if unknown
 public:
 	SysInfo();
 	std::string getOs() const {return _os;}
 	uint64_t getPhysicalMemory() const {return _physicalMemory;}
+	uint64_t getL1DataCacheSize() const {return _l1DataCacheSize;}
+	uint64_t getL2CacheSize() const {return _l2CacheSize;}
+	uint64_t getL3CacheSize() const {return _l3CacheSize;}
+	uint16_t getL2SharingThreads() const {return _l2SharingThreads;}
+	uint16_t getL3SharingThreads() const {return _l3SharingThreads;}
 	std::string getCpuArchitecture() const {return _cpuArchitecture;}
 	std::string getCpuBrand() const {return _cpuBrand;}
 	bool hasAVX() const {return _avx;}
 	bool hasAVX2() const {return _avx2;}
 	bool hasAVX512() const {return _avx512;}
+	bool hasAVX512IFMA() const {return _avx512Ifma;}
+	std::vector<CoreClass> getCoreClasses() const {return _coreClasses;}
 };
 
 inline SysInfo sysInfo;
@@ -96,15 +112,26 @@ template<class T> class TsQueue {
 	std::deque<T> _q;
 	std::mutex _m;
 	std::condition_variable _cv;
+	std::atomic<uint32_t> _size{0}; // Allows to get the size or skip an empty queue without locking
 public:
 	void push_back(T item) {
 		std::unique_lock<std::mutex> lock(_m);
 		_q.push_back(item);
+		_size = _q.size();
 		_cv.notify_one();
 	}
+	void push_back(const T* items, const std::size_t count) { // Pushes several items while taking the lock only once
+		if (count == 0) return;
+		std::unique_lock<std::mutex> lock(_m);
+		_q.insert(_q.end(), items, items + count);
+		_size = _q.size();
+		if (count == 1) _cv.notify_one();
+		else _cv.notify_all();
+	}
 	void push_front(T item) {
 		std::unique_lock<std::mutex> lock(_m);
 		_q.push_front(item);
+		_size = _q.size();
 		_cv.notify_one();
 	}
 	T blocking_pop_front() { // Blocks until an item is available to pop
@@ -113,24 +140,155 @@ public:
 			_cv.wait(lock);
 		auto r(_q.front());
 		_q.pop_front();
+		_size = _q.size();
 		return r;
 	}
+	template <class Rep, class Period> bool pop_front_for(T& item, const std::chrono::duration<Rep, Period> &timeout) { // Like try_pop_front, but waits up to the timeout for an item
+		std::unique_lock<std::mutex> lock(_m);
+		if (!_cv.wait_for(lock, timeout, [this] {return !_q.empty();})) return false;
+		item = _q.front();
+		_q.pop_front();
+		_size = _q.size();
+		return true;
+	}
 	bool try_pop_front(T& item) { // Pops the front and returns true if the queue isn't empty else returns false.
+		if (_size == 0) return false;
 		std::lock_guard<std::mutex> lock(_m);
 		if (_q.empty()) return false;
 		item = _q.front();
 		_q.pop_front();
+		_size = _q.size();
 		return true;
 	}
 	typename std::deque<T>::size_type clear() { // Nonblocking - clears queue, returns number of items removed
 		std::unique_lock<std::mutex> lock(_m);
 		auto s(_q.size());
 		_q.clear();
+		_size = 0;
 		return s;
 	}
-	uint32_t size() {
-		std::unique_lock<std::mutex> lock(_m);
-		return _q.size();
+	uint32_t size() const {return _size;}
+};
+
+// Chase-Lev Work Stealing Deque with a fixed capacity, for trivially copyable items. Only its owner pushes and pops at the bottom, other threads steal from the top.
+// A thief copies the item before claiming it, and discards the copy if it could not, so the owner never has to wait.
+template<class T, int64_t capacity> class WsDeque {
+	static_assert((capacity & (capacity - 1)) == 0, "The capacity must be a power of 2");
+	alignas(64) std::atomic<int64_t> _top{0};
+	alignas(64) std::atomic<int64_t> _bottom{0};
+	std::unique_ptr<T[]> _items{new T[capacity]};
+public:
+	bool push(const T &item) { // Returns false if full
+		const int64_t bottom(_bottom.load(std::memory_order_relaxed));
+		if (bottom - _top.load(std::memory_order_acquire) >= capacity) return false;
+		_items[bottom & (capacity - 1)] = item;
+		_bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+	bool pop(T &item) { // Pops the last pushed item
+		const int64_t bottom(_bottom.load(std::memory_order_relaxed) - 1);
+		_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top(_top.load(std::memory_order_relaxed));
+		if (top > bottom) { // Empty
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+		item = _items[bottom & (capacity - 1)];
+		if (top == bottom) { // Last item, race against the thieves
+			const bool won(_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed));
+			_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	}
+	bool steal(T &item) { // Steals the oldest item, can fail if another thread took it first
+		int64_t top(_top.load(std::memory_order_acquire));
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom(_bottom.load(std::memory_order_acquire));
+		if (top >= bottom) return false;
+		item = _items[top & (capacity - 1)];
+		return _top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+	int64_t size() const {return std::max(_bottom.load(std::memory_order_relaxed) - _top.load(std::memory_order_relaxed), static_cast<int64_t>(0));}
+	void clear() { // Only when no other thread uses the deque
+		_top = 0;
+		_bottom = 0;
+	}
+};
+
+// Pool of fixed size blocks, allocated by slabs that are only freed with the pool, so a block never moves. The blocks are referred by 32 bits handles, which keeps small the items that point to them.
+// The blocks can be given back individually, or all at once with reset, after which the ones given back for an older generation are ignored.
+template<class T, uint32_t slabSize, uint32_t maxSlabs> class SlabPool {
+	static_assert(static_cast<uint64_t>(slabSize)*maxSlabs <= UINT32_MAX, "The handles must fit in 32 bits");
+	std::mutex _mutex;
+	std::unique_ptr<std::unique_ptr<T[]>[]> _slabs{new std::unique_ptr<T[]>[maxSlabs]}; // Fixed array, so the blocks can be accessed without locking while other slabs are added
+	uint32_t _nSlabs{0}, _slabsLimit{maxSlabs};
+	std::vector<uint32_t> _freeHandles;
+	std::atomic<uint64_t> _generation{0};
+public:
+	bool allocate(uint32_t* handles, const uint32_t count) { // Returns false without allocating anything if the pool cannot provide all the blocks
+		std::lock_guard<std::mutex> lock(_mutex);
+		while (_freeHandles.size() < count) {
+			if (_nSlabs >= _slabsLimit) return false;
+			try {_slabs[_nSlabs].reset(new T[slabSize]);}
+			catch (std::bad_alloc&) {return false;}
+			for (uint32_t j(slabSize) ; j > 0 ; j--) _freeHandles.push_back(_nSlabs*slabSize + j - 1);
+			_nSlabs++;
+		}
+		for (uint32_t i(0) ; i < count ; i++) {
+			handles[i] = _freeHandles.back();
+			_freeHandles.pop_back();
+		}
+		return true;
+	}
+	void free(const uint32_t* handles, const uint32_t count, const uint64_t generation) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (generation == _generation.load(std::memory_order_relaxed))
+			_freeHandles.insert(_freeHandles.end(), handles, handles + count);
+	}
+	void reset() { // Only when no block is in use anymore
+		std::lock_guard<std::mutex> lock(_mutex);
+		_generation.fetch_add(1, std::memory_order_relaxed);
+		_freeHandles.resize(_nSlabs*slabSize);
+		std::iota(_freeHandles.rbegin(), _freeHandles.rend(), 0);
+	}
+	void limit(const uint32_t slabsLimit) { // The slabs already allocated are kept
+		std::lock_guard<std::mutex> lock(_mutex);
+		_slabsLimit = std::clamp(slabsLimit, 1U, maxSlabs);
+	}
+	uint64_t capacity() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		return static_cast<uint64_t>(std::max(_slabsLimit, _nSlabs))*slabSize;
+	}
+	uint64_t available() { // Blocks that can still be allocated
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _freeHandles.size() + static_cast<uint64_t>(_slabsLimit > _nSlabs ? _slabsLimit - _nSlabs : 0)*slabSize;
+	}
+	T& operator[](const uint32_t handle) {return _slabs[handle/slabSize][handle % slabSize];}
+	uint64_t generation() const {return _generation.load(std::memory_order_relaxed);}
+};
+
+// Worker Threads kept for the whole process, so restarting an Instance does not recreate them and the next Instance can reuse their thread_local memory.
+// An Instance attaches to the pool to run a function in its first Workers (more are created if needed), and detaching waits until they all returned from it.
+class WorkerPool {
+	std::vector<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _attachCv, _detachCv;
+	std::function<void(uint16_t)> _function;
+	uint16_t _attachedThreads{0}, _runningThreads{0};
+	uint64_t _attachments{0}; // So a Worker runs the function only once per attachment
+	bool _stopping{false};
+	WorkerPool() = default;
+	~WorkerPool();
+	void _run(const uint16_t);
+public:
+	static WorkerPool& instance();
+	void attach(const uint16_t, const std::function<void(uint16_t)>&);
+	void detach(); // The function must have been told to return
+	uint16_t size() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _threads.size();
 	}
 };
 
@@ -145,10 +303,15 @@ template <class C> std::string formatContainer(const C& container) {
 
 // Parameters for the Stella Instance, auto tuned if left as below.
 struct Configuration {
-	uint16_t threads{0}, sieveWorkers{0};
+	uint16_t threads{0}, sieveWorkers{0}, sievePartitions{1}, pipelineDepth{2}, jobPrefetch{2};
+	bool adaptiveSieveDepth{true}, interleavedSieveLayout{false};
 	uint64_t primeTableLimit{0}, sieveBits{0}, sieveSize{0}, sieveWords{0}, sieveIterations{0};
 	std::vector<uint64_t> pattern{}, primorialOffsets{};
 	std::vector<bool> patternMin{};
+	std::vector<CoreClass> coreClasses{}; // Class of each logical CPU, detected if empty
+	uint16_t backpressureQueuePerThread{4};
+	double backpressureMaxStaleTime{0.25}; // In s
+	uint64_t candidatesPoolSize{256}; // In MiB, shared by the Work Slots
 	uint32_t primeCountTarget{0}, primeCountMin{0};
 	uint64_t initialBits{0}, initialTargetBits{0};
 };
@@ -171,6 +334,66 @@ struct Result {
 	uint64_t primorialFactor, primorialOffset;
 };
 
+// Stats of the verification of the Results with the consensus primality test, done before giving them to the Client.
+struct VerificationStats {
+	uint64_t results, discardedResults, pseudoprimes; // Pseudoprimes are numbers passing the base 2 Fermat Test but not the consensus one
+	double averageLatency, maxLatency; // Time between the finding of a Result and the end of its verification, in s
+};
+
+// Stats of the Job transitions: how long the Master Thread waited for new Jobs, and how long the Workers were idle, in s.
+struct JobStats {
+	uint64_t jobs;
+	double jobWaitTime, idleTime;
+};
+
+// State and decisions of the Backpressure Controller, see below.
+struct BackpressureStats {
+	enum Decision {Increase, Adjust, Saturated, Skip, Decisions};
+	uint32_t target, targetMin, targetMax;
+	uint32_t lastRemainingTasks, lastQueuedTasksMin; // Observed when the last Job was retired
+	double checkTaskRate; // Measured Check Tasks done per s
+	std::array<uint64_t, Decisions> decisions; // Counts
+	Decision lastDecision;
+	uint64_t throttledSieves; // Sieve Tasks deferred as the Candidates Pool was running out
+	uint64_t droppedCandidates; // Not given to Check Tasks as the Candidates Pool was full, counted by the Instance
+};
+
+// Chooses how many Check Tasks of a Job may still be queued when its Sieves are done and the next Job starts (the Target). These keep the Workers busy while the next Job is presieved.
+// Objectives: the lowest number of queued Tasks seen during the Sieves should be at least queuePerThread*Threads (idle Workers otherwise), and the Target must not exceed what the Workers test in maxStaleTime (bounding the work lost if the Job is invalidated).
+// Called by the Master Thread, the stats can be read from any thread.
+class BackpressureController {
+	mutable std::mutex _mutex;
+	BackpressureStats _stats;
+	uint32_t _threads;
+	double _maxStaleTime;
+public:
+	void init(const uint32_t threads, const uint32_t initialTarget, const uint32_t queuePerThread, const double maxStaleTime) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_threads = threads;
+		_maxStaleTime = maxStaleTime;
+		_stats = BackpressureStats{};
+		_stats.targetMin = queuePerThread*threads;
+		_stats.targetMax = UINT32_MAX; // Until the Check Task Rate is known
+		_stats.target = std::max(initialTarget, _stats.targetMin);
+		_stats.lastDecision = BackpressureStats::Skip;
+	}
+	uint32_t target() const {
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _stats.target;
+	}
+	BackpressureStats stats() const {
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _stats;
+	}
+	void update(const bool measurable, const uint32_t remainingTasks, const uint32_t queuedTasksMin, const double checkTaskRate);
+	bool throttleSieve(const uint64_t availableBlocks, const uint64_t capacity, const uint64_t neededBlocks) { // Whether the next Sieve Task should wait for the Check Tasks to free Candidates Pool blocks
+		if (availableBlocks >= capacity/4 && availableBlocks >= 2*neededBlocks) return false;
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stats.throttledSieves++;
+		return true;
+	}
+};
+
 inline mpz_class u64ToMpz(const uint64_t u64) {
 	mpz_class mpz;
 	mpz_import(mpz.get_mpz_t(), 1, 1, 8, 0, 0, &u64);
@@ -185,8 +408,15 @@ inline std::vector<mpz_class> v64ToVMpz(const std::vector<uint64_t> &v64) {
 }
 
 constexpr uint32_t sieveCacheSize(32);
-constexpr uint32_t nWorks(2);
+constexpr uint16_t maxPipelineDepth(4);
 constexpr uint32_t maxCandidatesPerCheckTask(64);
+constexpr uint32_t candidatesSlabBlocks(1024), candidatesMaxSlabs(4096); // Candidates Pools of a Work, with blocks of maxCandidatesPerCheckTask candidates
+constexpr std::size_t maxTupleCounts(32); // Counts kept per Worker, so the Constellation Patterns can have up to maxTupleCounts - 1 numbers
+constexpr int64_t workerDequeCapacity(1024); // Tasks per Worker Deque, the extra ones go to the shared Back Queue
+constexpr uint32_t sieveCancellationChunks(32); // A Sieve pass is split in ranges of primes of about equal cost, checking between them whether the Work is still current
+constexpr uint64_t presieveCancellationPrimes(4096); // Presieve Tasks check whether the Work is still current every this number of primes (must be a power of 2)
+constexpr std::size_t workSwitchLatencyBuckets(12); // Bucket i > 0 counts the Work Switch Latencies in [2^(i - 1), 2^i[ ms, the first one those < 1 ms and the last one those >= 1024 ms
+using WorkSwitchLatencies = std::array<uint64_t, workSwitchLatencyBuckets>;
 // Create an Instance to generate Prime Constellations. It must be initialized with parameters appropriate for the Stella Jobs that will be worked on by the Instance.
 // Altering the initial parameters require a reinitialization of the Instance (or making a new one).
 class Instance {
@@ -206,27 +436,50 @@ class Instance {
 #endif
 	struct Sieve {
 		uint32_t id;
-		std::mutex presieveLock;
 		uint64_t *factorsTable = nullptr; // Booleans corresponding to whether a primorial factor is eliminated
-		uint32_t *factorsToEliminate = nullptr; // One entry for each constellation offset, for each prime number p < factorMax (the factors are in the form of indexes of the factorsTable)
+		uint64_t **partFactorsTables = nullptr; // If the Sieve is partitioned, one table per partition (the first one being the factorsTable), OR-reduced into the factorsTable once all the partitions were processed
+		std::atomic<uint32_t> nRemainingPartitions{0};
+		uint32_t *factorsToEliminate = nullptr; // One entry for each constellation offset, for each prime number p < factorMax (the factors are in the form of indexes of the factorsTable). With the Interleaved Layout, one record per prime of the entries, padding, then p
 		uint32_t **additionalFactorsToEliminate = nullptr; // Factors for p >= factorMax (they are eliminated only once and treated separately), arranged by Sieve Iteration (also in the form of indexes of the factorsTable)
 		std::atomic<uint64_t> *additionalFactorsToEliminateCounts = nullptr; // Counts for each Sieve Iteration
 	};
 	
 	struct MinerWork {
-		bool current{true};
+		std::atomic<bool> current{true}; // Cleared by invalidateWork, checked regularly by the Tasks including during sieving and presieving
 		Stella::Job job;
 		mpz_class primorialMultipleStart{0}; // Smallest multiple of the primorial >= target.
+		uint32_t sieveSet{0}; // Which set of Sieves is used, a new Job can be presieved in another one while the previous Job is still sieving
+		uint64_t nPrimesEffective{0}; // Primes used for this Job, the Sieve Depth can be adjusted for the next Jobs before it is sieved
+		uint32_t queuedTasksAtStart{0};
+		std::atomic<uint32_t> nQueuedTasksMin{UINT32_MAX}; // Lowest number of queued Tasks seen while its Sieves run
+		std::array<std::atomic<uint64_t>, 3> phaseTimes{}; // Time spent in its Presieve, Sieve and Check Tasks, in µs, so the Jobs overlapping in the Pipeline are measured separately
+		std::atomic<uint64_t> candidates{0}; // Put in its Check Tasks
+		uint32_t generation{0}; // Work Generation when the Job was started, given to its Tasks
+		std::atomic<bool> lookahead{false}; // Whether the Job was started while an older one is still sieving, its Presieve and Sieve Tasks then have the lowest priority so they only use the idle time
+		// Dependency counters, decremented by the Workers when they finish a Task. The Worker finishing the last normal Presieve Task starts the Sieves, and the Master Thread is only notified of the milestones.
+		std::atomic<int32_t> nRemainingNormalPresieveTasks{0}, nRemainingAdditionalPresieveTasks{0}, nRemainingSieves{0};
 		std::atomic<uint64_t> nRemainingCheckTasks{0};
+		std::atomic<uint64_t> checkTasksNotifyAt{UINT64_MAX}; // The Master is notified when the number of remaining Check Tasks drops to this
+		SlabPool<std::array<uint32_t, maxCandidatesPerCheckTask>, candidatesSlabBlocks, candidatesMaxSlabs> candidatesPool; // Candidates of the Check Tasks, given back when they are done, or all at once when the Work Slot is reused
 		void clear() {
 			primorialMultipleStart = 0;
+			nRemainingNormalPresieveTasks = 0;
+			nRemainingAdditionalPresieveTasks = 0;
+			nRemainingSieves = 0;
 			nRemainingCheckTasks = 0;
+			checkTasksNotifyAt = UINT64_MAX;
+			lookahead = false;
+			nQueuedTasksMin = UINT32_MAX;
+			for (auto &phaseTime : phaseTimes) phaseTime = 0;
+			candidates = 0;
+			candidatesPool.reset();
 		}
 	};
 	
 	struct Task {
 		enum Type {Dummy, Presieve, Sieve, Check};
 		Type type;
+		uint32_t generation; // Work Generation of its Work, so a Task created before an invalidation is known as outdated even if it is taken after
 		uint64_t workIndex;
 		union {
 			struct {} dummy;
@@ -236,50 +489,56 @@ class Instance {
 			} presieve;
 			struct {
 				uint32_t id;
+				uint32_t partition; // Range of prime indexes to eliminate, if the Sieve is partitioned
 				uint64_t iteration;
 			} sieve;
 			struct {
 				uint32_t offsetId;
 				uint32_t nCandidates;
 				uint32_t factorStart; // The form of a candidate is firstCandidate + primorial*f, with f = factorStart + factorOffset
-				std::array<uint32_t, maxCandidatesPerCheckTask> factorOffsets;
+				uint32_t candidates; // Handle of the factor offsets in the Candidates Pool of the Work
 			} check;
 		};
 
-		static Task PresieveTask(uint64_t workIndex, uint64_t start, uint64_t end) {
+		static Task PresieveTask(uint64_t workIndex, uint32_t generation, uint64_t start, uint64_t end) {
 			Task task;
 			task.type = Presieve;
+			task.generation = generation;
 			task.workIndex = workIndex;
 			task.presieve.start = start;
 			task.presieve.end = end;
 			return task;
 		}
-		static Task SieveTask(uint64_t workIndex, uint32_t id, uint64_t iteration) {
+		static Task SieveTask(uint64_t workIndex, uint32_t generation, uint32_t id, uint64_t iteration, uint32_t partition = 0) {
 			Task task;
 			task.type = Sieve;
+			task.generation = generation;
 			task.workIndex = workIndex;
 			task.sieve.id = id;
+			task.sieve.partition = partition;
 			task.sieve.iteration = iteration;
 			return task;
 		}
 	};
 	
-	// Used for task synchronization and balancing purposes like ensuring that all Presieve Task finished before generating Sieve Tasks.
-	struct TaskDoneInfo {
-		Task::Type type;
-		union {
-			uint64_t workIndex;
-			uint64_t firstPrimeIndex;
-		};
-	};
-	
-	uint16_t _threads, _sieveWorkers;
+	uint16_t _threads, _sieveWorkers, _sievePartitions, _pipelineDepth, _jobPrefetch;
 	std::thread _masterThread;
-	std::vector<std::thread> _workerThreads;
+	bool _coreClassScheduling; // If the Workers are on both Performance and Efficiency Cores, the latter only do Check Tasks
+	std::vector<int32_t> _workerCpus; // Logical CPU to which each Worker is pinned, -1 if none
+	std::vector<CoreClass> _workerCoreClasses;
 	// Miner data (generated in init)
 	mpz_class _primorial;
+	std::vector<uint32_t> _primorialLimbs; // As 32 bits limbs, to build the candidates directly for the Fermat Test Kernel
 	uint64_t _primorialNumber, _primeTableLimit, _nPrimes, _nPrimes32, _factorMax, _primesIndexThreshold;
+	bool _adaptiveSieveDepth;
+	std::atomic<uint64_t> _nPrimesEffective; // How many primes of the table are used for sieving, can be adjusted between Jobs
 	uint64_t _sieveBits, _sieveSize, _sieveWords, _sieveIterations;
+	bool _interleavedSieveLayout;
+	uint64_t _factorsToEliminateStride; // Entries per prime in the factorsToEliminate
+	std::string _sieveGeometryInfo; // How the Sieve Size was chosen, if automatically
+	std::vector<uint64_t> _sievePartitionsBounds; // Prime indexes delimiting the ranges processed by each partition of a Sieve
+	std::vector<uint64_t> _sieveChunksBounds; // Ends of the ranges of primes after which a Sieve Task checks whether its Work is still current
+	uint64_t _candidatesPerIteration, _candidatesPoolBlocks; // Expected from a Sieve iteration, and blocks that the Candidates Pool of a Work Slot can provide
 	std::vector<uint32_t> _primes32, _modularInverses32; // Use 32 bits Ints to save Memory
 	std::vector<uint64_t> _primes64, _modularInverses64;
 #ifdef __SSE2__
@@ -292,24 +551,72 @@ class Instance {
 	// Miner state variables
 	bool _inited, _running, _keepStats;
 	TsQueue<Job> _availableJobs;
-	TsQueue<Task> _presieveTasks, _tasks;
-	TsQueue<TaskDoneInfo> _tasksDoneInfos;
-	std::vector<Sieve> _sieves;
-	std::array<MinerWork, nWorks> _works; // Alternating work for better efficiency when there is a new block
-	uint32_t _nRemainingCheckTasksTarget, _currentWorkIndex;
-	std::chrono::microseconds _presieveTime, _sieveTime, _verifyTime;
+	std::mutex _jobRequestMutex;
+	std::condition_variable _jobRequestCv;
+	bool _jobRequested; // Set when the Master Thread takes a Job and less than _jobPrefetch remain
+	// Tasks are taken in this order: Presieve Tasks, Tasks put in front (Sieve starts), the Worker's own Deque (latest first, so a Sieve continues with its next iteration), the Back Queue (Deques overflow), the oldest Tasks of the other Workers, and finally the Tasks of the Jobs started ahead.
+	enum class TaskQueue {Presieve, Front, Back, Worker, Lookahead, Check};
+	TsQueue<Task> _presieveTasks, _frontTasks, _backTasks, _lookaheadTasks, _checkTasks; // The Check Queue is only used with the Core Class Scheduling, so all the Check Tasks are where the Efficiency Workers look for them
+	std::vector<std::unique_ptr<WsDeque<Task, workerDequeCapacity>>> _workerTasks;
+	std::atomic<int64_t> _nQueuedTasks; // In all the queues, incremented before pushing so Workers do not sleep while a Task is being pushed
+	std::atomic<int64_t> _nQueuedCheckTasks; // Same for the Check Queue, so the Efficiency Workers can sleep until a Task for them is pushed
+	std::atomic<uint16_t> _nSleepingWorkers;
+	std::mutex _sleepMutex;
+	std::condition_variable _sleepCv;
+	std::mutex _masterMutex, _presieveMutex;
+	std::condition_variable _masterCv, _presieveCv; // To notify the Master Thread of a milestone, and the Sieves waiting for the Additional Presieve Tasks
+	std::vector<Sieve> _sieves; // One set of sieveWorkers Sieves per Pipeline stage
+	std::vector<MinerWork> _works; // Work Slots used in turn, one more than the Pipeline Depth so the Check Tasks of a Job can finish while the next Jobs are presieved and sieved
+	BackpressureController _backpressure;
+	uint32_t _currentWorkIndex;
+	std::atomic<uint64_t> _jobsStarted, _jobWaitTimeTotal; // In µs
+	std::atomic<uint64_t> _droppedCandidates;
+	// Stats written by a single Worker and summed when read, without locks. Each Worker has its own Cache Lines, so they do not slow down each other. Times in µs.
+	struct alignas(64) WorkerCounters {
+		std::atomic<uint64_t> presieveTime{0}, sieveTime{0}, checkTime{0}, idleTime{0}, checkTasksDone{0};
+		std::array<std::atomic<uint64_t>, maxTupleCounts> tupleCounts{};
+		static void add(std::atomic<uint64_t> &counter, const uint64_t value) {counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);} // No atomic read-modify-write needed with a single writer
+		void add(const WorkerCounters &other) {
+			for (auto counter : {&WorkerCounters::presieveTime, &WorkerCounters::sieveTime, &WorkerCounters::checkTime, &WorkerCounters::idleTime, &WorkerCounters::checkTasksDone})
+				add(this->*counter, other.*counter);
+			for (std::size_t i(0) ; i < maxTupleCounts ; i++) add(tupleCounts[i], other.tupleCounts[i]);
+		}
+		void clear() {
+			for (auto counter : {&WorkerCounters::presieveTime, &WorkerCounters::sieveTime, &WorkerCounters::checkTime, &WorkerCounters::idleTime, &WorkerCounters::checkTasksDone})
+				this->*counter = 0;
+			for (auto &tupleCount : tupleCounts) tupleCount = 0;
+		}
+	};
+	std::unique_ptr<WorkerCounters[]> _workerCounters; // Only while the Threads run
+	WorkerCounters _keptCounters; // Of the previous runs if the Stats are kept
+	std::size_t _nTupleCounts; // Pattern Size + 1 when the Tuple Counts were reset
+	mutable std::mutex _countersMutex; // Taken by the readers of the counters and when the Worker Counters are replaced or freed, the Workers write without it
+	// Work Switch Latency: time from an invalidateWork call until no Worker is on outdated Work anymore. Each Worker publishes the Work Generation of the Task that it is doing, or UINT64_MAX if idle.
+	struct alignas(64) WorkerGeneration {std::atomic<uint64_t> generation{UINT64_MAX};};
+	std::unique_ptr<WorkerGeneration[]> _workerGenerations;
+	std::atomic<uint64_t> _workGeneration;
+	std::atomic<bool> _workSwitchPending;
+	std::atomic<int64_t> _workSwitchStart; // Time of the last invalidation, in steady_clock ticks
+	std::array<std::atomic<uint64_t>, workSwitchLatencyBuckets> _workSwitchLatencies;
 	
 	// Stats and Results
 	bool _primeTableExtracted;
 	double _primeTableGenerationTime, _modularInversesGenerationTime;
-	std::vector<uint64_t> _tupleCounts;
 	std::vector<Result> _results;
-	std::mutex _countsLock, _resultMutex;
+	std::mutex _resultMutex;
 	std::vector<std::string> _initMessages;
+	// Results found by the Workers, to be verified by the Verifier Thread before being made available
+	struct ResultToVerify {
+		bool stop; // Set to stop the Verifier Thread
+		Result result;
+		std::chrono::steady_clock::time_point foundTp;
+	};
+	std::thread _verifierThread;
+	TsQueue<ResultToVerify> _resultsToVerify;
+	std::atomic<uint64_t> _resultsVerified, _resultsDiscarded, _pseudoprimes, _verificationLatencyTotal, _verificationLatencyMax; // Latencies in µs
 	
 	void _addResult(const Result &result) {
-		std::lock_guard<std::mutex> lock(_resultMutex);
-		_results.push_back(result);
+		_resultsToVerify.push_back(ResultToVerify{false, result, std::chrono::steady_clock::now()});
 	}
 	
 	void _addToSieveCache(uint64_t *sieve, std::array<uint32_t, sieveCacheSize> &sieveCache, uint64_t &pos, uint32_t ent) {
@@ -339,14 +646,45 @@ class Instance {
 #ifdef __AVX2__
 	void _processSieve7_avx2(uint64_t*, uint32_t*, uint64_t, const uint64_t);
 	void _processSieve8_avx2(uint64_t*, uint32_t*, uint64_t, const uint64_t);
-	bool _testPrimesIspc(const std::array<uint32_t, maxCandidatesPerCheckTask>&, uint32_t[maxCandidatesPerCheckTask], const mpz_class&, mpz_class&);
 #endif
 #endif
+	bool _fermatTestKernel(const uint32_t, const uint64_t, uint32_t*, uint32_t*);
+	void _testTupleCandidates(const bool, std::vector<uint64_t>&);
+	void _adjustSieveDepth(const MinerWork&);
+	uint64_t _sumCounters(std::atomic<uint64_t> WorkerCounters::*) const;
+	std::array<uint64_t, 3> _phaseTimes() const {return {_sumCounters(&WorkerCounters::presieveTime), _sumCounters(&WorkerCounters::sieveTime), _sumCounters(&WorkerCounters::checkTime)};}
+	void _processSieveInterleaved(uint64_t*, uint32_t*, const uint64_t, const uint64_t);
+#ifdef __SSE2__
+	template <uint32_t nVectors> void _processSieveInterleavedSse(uint64_t*, uint32_t*, const uint64_t, const uint64_t);
+#endif
+	void _processSievePrimesRange(uint64_t*, uint32_t*, const uint64_t, const uint64_t);
+	bool _processSievePrimes(const uint64_t, uint64_t*, uint32_t*, const uint64_t, const uint64_t);
+	void _setWorkerGeneration(const uint64_t);
+	void _checkWorkSwitch();
+	void _pushTasks(const Task*, const std::size_t, const TaskQueue);
+	bool _popTask(Task&);
+	bool _popCheckTask(Task&);
+	void _promoteLookaheadTasks();
+	Task _waitForTask();
+	void _pushSieveTasks(const uint64_t, const uint32_t, const uint64_t, const bool, const bool = false);
+	void _startSieves(const uint64_t);
+	void _presieveTaskDone(const Task&);
+	void _checkTaskDone(const uint64_t);
+	void _notifyMaster();
+	uint32_t _queuedTasks() const {return std::max(_nQueuedTasks.load(), static_cast<int64_t>(0));} // The count can be briefly negative as it is decremented after a pop
+	uint32_t _extractCandidates(const uint64_t*, const uint32_t, const uint32_t, uint32_t*);
 	void _doSieveTask(Task);
 	void _doCheckTask(Task);
+	void _freeCandidates(const uint16_t, const uint32_t);
+	void _flushFreedCandidates();
+	void _updateTupleCounts(const std::vector<uint64_t>&);
 	void _doTasks(uint16_t);
 	void _manageTasks();
+	void _verifyResults();
 
+	Sieve& _sieve(const uint64_t workIndex, const uint32_t id) {
+		return _sieves[_works[workIndex].sieveSet*_sieveWorkers + id];
+	}
 	uint64_t _getPrime(uint64_t i) const {
 		if (i < _nPrimes32) return _primes32[i];
 		else return _primes64[i - _nPrimes32];
@@ -359,7 +697,12 @@ public:
 	Instance() :
 		_inited(false), _running(false), _keepStats(false) {
 		_nPrimes = 0;
+		_nPrimesEffective = 0;
 		_primesIndexThreshold = 0;
+		_jobPrefetch = 1;
+		_jobRequested = false;
+		_nTupleCounts = 0;
+		_workGeneration = 0;
 	}
 	
 	bool hasAcceptedPatterns(const std::vector<std::vector<uint64_t>>&) const;
@@ -378,6 +721,12 @@ public:
 		}
 	}
 	uint64_t availableJobs() {return _availableJobs.size();}
+	bool needsJobs() {return _availableJobs.size() < _jobPrefetch;}
+	template <class Rep, class Period> void waitForJobRequest(const std::chrono::duration<Rep, Period> &timeout) { // Returns early if the Master Thread took a Job and more should be added
+		std::unique_lock<std::mutex> lock(_jobRequestMutex);
+		_jobRequestCv.wait_for(lock, timeout, [this] {return _jobRequested;});
+		_jobRequested = false;
+	}
 	void startThreads();
 	void invalidateWork();
 	void stop(const bool keepStats = true) {
@@ -397,15 +746,54 @@ public:
 		return results;
 	}
 	
-	std::vector<uint64_t> getTupleCounts() {
-		std::lock_guard<std::mutex> lock(_countsLock);
-		return _tupleCounts;
+	VerificationStats getVerificationStats() const {
+		const uint64_t resultsVerified(_resultsVerified);
+		return {resultsVerified, _resultsDiscarded, _pseudoprimes, resultsVerified > 0 ? static_cast<double>(_verificationLatencyTotal)/(1e6*static_cast<double>(resultsVerified)) : 0., static_cast<double>(_verificationLatencyMax)/1e6};
+	}
+	
+	std::vector<uint64_t> getTupleCounts() const;
+	
+	WorkSwitchLatencies getWorkSwitchLatencies() const {
+		WorkSwitchLatencies workSwitchLatencies;
+		for (std::size_t i(0) ; i < workSwitchLatencyBuckets ; i++) workSwitchLatencies[i] = _workSwitchLatencies[i];
+		return workSwitchLatencies;
+	}
+	
+	BackpressureStats getBackpressureStats() const {
+		BackpressureStats backpressureStats(_backpressure.stats());
+		backpressureStats.droppedCandidates = _droppedCandidates;
+		return backpressureStats;
+	}
+	
+	JobStats getJobStats() const {
+		return {_jobsStarted, static_cast<double>(_jobWaitTimeTotal)/1e6, static_cast<double>(_sumCounters(&WorkerCounters::idleTime))/1e6};
+	}
+	
+	std::array<double, 3> getPhaseTimes() const { // Total time spent by all the Threads in Presieve, Sieve and Check Tasks, in s
+		const std::array<uint64_t, 3> phaseTimes(_phaseTimes());
+		return {static_cast<double>(phaseTimes[0])/1e6, static_cast<double>(phaseTimes[1])/1e6, static_cast<double>(phaseTimes[2])/1e6};
+	}
+	
+	std::array<double, 3> getEfficiencyPhaseTimes() const; // Same for the Efficiency Workers of the current run only, to check that they only test candidates
+	bool coreClassScheduling() const {return _coreClassScheduling;}
+	
+	uint64_t getEffectivePrimeTableLimit() const { // Largest prime currently used for sieving
+		const uint64_t nPrimesEffective(_nPrimesEffective);
+		return nPrimesEffective > 0 ? _getPrime(nPrimesEffective - 1ULL) : 0ULL;
 	}
 	
 	std::string paramsStr() const {
 		if (_inited) {
 			std::string str;
 			str += "\tThreads: "s + std::to_string(_threads) + " ("s + std::to_string(_sieveWorkers) + " Sieve Worker(s))\n"s;
+			if (_sievePartitions > 1)
+				str += "\tSieve Partitions: "s + std::to_string(_sievePartitions) + " threads can work on each Sieve\n"s;
+			if (_pipelineDepth > 1)
+				str += "\tPipeline Depth: "s + std::to_string(_pipelineDepth) + " Jobs can be presieved and sieved at the same time\n"s;
+			if (_coreClassScheduling) {
+				const auto nEfficiencyWorkers(std::count(_workerCoreClasses.begin(), _workerCoreClasses.end(), CoreClass::Efficiency));
+				str += "\tCore Classes: "s + std::to_string(_threads - nEfficiencyWorkers) + " Worker(s) on Performance Cores, "s + std::to_string(nEfficiencyWorkers) + " on Efficiency Cores only testing candidates\n"s;
+			}
 			str += "\tConstellation pattern: n + ("s + formatContainer(_patternCumulative) + "), length "s + std::to_string(_pattern.size()) + "\n"s;
 			str += "\tPrime Table: "s + std::to_string(_nPrimes) + " entries, largest " + std::to_string(_getPrime(_nPrimes - 1ULL)) + "\n"s;
 			if (_primeTableExtracted)
@@ -421,9 +809,16 @@ public:
 			str += " ("s + std::to_string(mpz_sizeinbase(_primorial.get_mpz_t(), 2)) + " bits)\n"s;
 			str += "\tSieve Size: 2^"s + std::to_string(_sieveBits) + " = "s + std::to_string(_sieveSize) + " ("s + std::to_string(_sieveWords) + " words)\n"s;
 			str += "\tSieve Iterations: "s + std::to_string(_sieveIterations) + "\n"s;
+			if (_interleavedSieveLayout)
+				str += "\tSieve Layout: Interleaved, "s + std::to_string(_factorsToEliminateStride) + " entries per prime\n"s;
+			if (!_sieveGeometryInfo.empty())
+				str += "\t"s + _sieveGeometryInfo + "\n"s;
+			str += "\tCandidates Pool: "s + std::to_string(_candidatesPoolBlocks*maxCandidatesPerCheckTask*sizeof(uint32_t) >> 20) + " MiB for each of the "s + std::to_string(_works.size()) + " Work Slots, about "s + std::to_string(_candidatesPerIteration) + " candidates expected per Sieve iteration\n"s;
 			str += "\tPrimorial Factor Max: "s + std::to_string(_sieveIterations*_sieveSize) + "\n"s;
 			str += "\tPrimorial Offsets: "s + std::to_string(_primorialOffsets.size()) + " entries\n"s;
 			str += "\tPrime index threshold: "s + std::to_string(_primesIndexThreshold) + "\n"s;
+			if (_adaptiveSieveDepth)
+				str += "\tAdaptive Sieve Depth: the number of primes used for sieving will be adjusted between Jobs\n"s;
 			return str;
 		}
 		else
@@ -445,6 +840,8 @@ std::vector<uint64_t> generatePrimeTable(const uint64_t);
 
 std::string doubleToString(const double, const uint16_t = 0U);
 std::string formattedCounts(const std::vector<uint64_t>&, const uint64_t = 0ULL);
+std::string formattedWorkSwitchLatencies(const WorkSwitchLatencies&);
+std::string formattedBackpressureStats(const BackpressureStats&);
 std::string formattedTime(const double&);
 std::string formattedClockTimeNow();
 std::string formattedDuration(const double&);
@@ -21,6 +21,22 @@
 
 #include "fermat.h"
 
+#ifdef FERMAT_PROFILE
+#include <chrono>
+thread_local uint64_t profileSetupNs = 0, profileKernelNs = 0, profileNumbers = 0;
+void fermatProfileGet(uint64_t* setupNs, uint64_t* kernelNs, uint64_t* numbers)
+{
+	*setupNs = profileSetupNs;
+	*kernelNs = profileKernelNs;
+	*numbers = profileNumbers;
+}
+#define PROFILE_START(name) const auto name = std::chrono::steady_clock::now()
+#define PROFILE_ADD(counter, start) counter += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()
+#else
+#define PROFILE_START(name) do { } while(0)
+#define PROFILE_ADD(counter, start) do { } while(0)
+#endif
+
 #define JOB_SIZE 16
 
 const unsigned char  binvert_limb_table[128] = {
@@ -140,9 +156,16 @@ void fermatTest(int N_Size, int listSize, uint32_t* M, uint32_t* is_prime, bool
 
 	while (listSize > 0)
 	{
+		PROFILE_START(setupStart);
 		uint32_t shift = setup_fermat(N_Size, JOB_SIZE, M, MI, R);
+		PROFILE_ADD(profileSetupNs, setupStart);
+		PROFILE_START(kernelStart);
 		if (use_avx512) ispc::fermat_test512(M, MI, R, is_prime, N_Size, shift);
 		else ispc::fermat_test(M, MI, R, is_prime, N_Size, shift);
+		PROFILE_ADD(profileKernelNs, kernelStart);
+#ifdef FERMAT_PROFILE
+		profileNumbers += JOB_SIZE;
+#endif
 		M += JOB_SIZE*N_Size;
 		is_prime += JOB_SIZE;
 		listSize -= JOB_SIZE;
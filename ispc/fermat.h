@@ -1,5 +1,10 @@
 #include <stdint.h>
 
-#define MAX_N_SIZE 64
+#define MAX_N_SIZE 64 // fermatTest supports N_Size from 6 to this, it is generated code with fixed sizes
+#define IFMA_MAX_N_SIZE 512 // fermatTestIfma supports N_Size from 1 to this. Only the IFMA kernel handles the larger sizes, without IFMA they are tested with GMP
 
 void fermatTest(int N_Size, int listSize, uint32_t* M, uint32_t* is_prime, bool use_avx512);
+void fermatTestIfma(int N_Size, int listSize, uint32_t* M, uint32_t* is_prime); // Needs AVX-512 F and IFMA
+#ifdef FERMAT_PROFILE
+void fermatProfileGet(uint64_t* setupNs, uint64_t* kernelNs, uint64_t* numbers); // Time spent by the calling thread in the setup and in the kernel of fermatTest, and numbers tested
+#endif
@@ -0,0 +1,256 @@
+/* Batched Fermat Test using the AVX-512 IFMA instructions (VPMADD52LUQ/VPMADD52HUQ).
+
+  Each of the 8 lanes of a vector holds a different number, with 52 bits limbs. The Montgomery
+  squarings use lazy reductions (values kept below 4*N), so no conditional subtraction is needed
+  until the end. The squarings use Karatsuba above KARATSUBA_THRESHOLD limbs, which matters for
+  the large numbers of record searches (up to IFMA_MAX_N_SIZE). Same interface as fermatTest,
+  only call it if the CPU supports AVX-512 F and IFMA. */
+
+#pragma GCC target("avx512f,avx512ifma")
+
+#include <immintrin.h>
+#include <gmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fermat.h"
+
+#define JOB_SIZE 16
+#define IFMA_LANES 8
+#define MAX_L52 ((IFMA_MAX_N_SIZE*32 + 4 + 51)/52) // 4*N must fit in the limbs
+#define KARATSUBA_THRESHOLD 80 // In 52 bits limbs, measured to be around the break even point (the Montgomery Reduction stays quadratic)
+
+static const uint64_t mask52 = (1ULL << 52) - 1;
+
+// x >> 52 in each lane, logical and arithmetic. The zero masking forms are used as GCC 12's _mm512_srli/srai_epi64 pass an uninitialized vector as source of the masked lanes,
+// which gives (maybe-)uninitialized warnings once inlined. The mask is full, so these are still plain VPSRLQ/VPSRAQ.
+static inline __m512i srli52(const __m512i x)
+{
+	return _mm512_maskz_srli_epi64((__mmask8) 0xFF, x, 52);
+}
+
+static inline __m512i srai52(const __m512i x)
+{
+	return _mm512_maskz_srai_epi64((__mmask8) 0xFF, x, 52);
+}
+
+// Extracts L 52 bits limbs from a number stored as n32 32 bits limbs.
+static void toLimbs52(const uint32_t* src, int n32, uint64_t* dst, int L)
+{
+	for (int k = 0; k < L; ++k)
+	{
+		const int offset = 52*k, w = offset >> 5;
+		unsigned __int128 window = 0;
+		for (int i = 2; i >= 0; --i)
+		{
+			window <<= 32;
+			if (w + i < n32) window |= src[w + i];
+		}
+		dst[k] = (uint64_t) (window >> (offset & 31)) & mask52;
+	}
+}
+
+// r[0 to n - 1] = a + b + carry normalized to 52 bits limbs, with signed values and carries (a - b can be done by passing -b), returns the last carry.
+static inline __m512i addNormalize(__m512i* r, const __m512i* a, const __m512i* b, int n, __m512i carry)
+{
+	const __m512i mask = _mm512_set1_epi64(mask52);
+	for (int j = 0; j < n; ++j)
+	{
+		const __m512i v = _mm512_add_epi64(_mm512_add_epi64(a[j], b[j]), carry);
+		r[j] = _mm512_and_si512(v, mask);
+		carry = srai52(v);
+	}
+	return carry;
+}
+
+// p[0 to 2n - 1] = a^2, with a normalized, p normalized.
+static void sqr52Basecase(__m512i* p, const __m512i* a, const int n)
+{
+	const __m512i zero = _mm512_setzero_si512(), mask = _mm512_set1_epi64(mask52);
+	__m512i t[2*KARATSUBA_THRESHOLD];
+	for (int k = 0; k < 2*n; ++k) t[k] = zero;
+	for (int i = 0; i < n; ++i)
+	{
+		for (int j = i + 1; j < n; ++j)
+		{
+			t[i + j] = _mm512_madd52lo_epu64(t[i + j], a[i], a[j]);
+			t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], a[i], a[j]);
+		}
+	}
+	for (int k = 0; k < 2*n; ++k) t[k] = _mm512_add_epi64(t[k], t[k]);
+	for (int i = 0; i < n; ++i)
+	{
+		t[2*i] = _mm512_madd52lo_epu64(t[2*i], a[i], a[i]);
+		t[2*i + 1] = _mm512_madd52hi_epu64(t[2*i + 1], a[i], a[i]);
+	}
+	__m512i carry = zero;
+	for (int k = 0; k < 2*n; ++k)
+	{
+		const __m512i v = _mm512_add_epi64(t[k], carry);
+		p[k] = _mm512_and_si512(v, mask);
+		carry = srli52(v);
+	}
+}
+
+// p[0 to 2n - 1] = a^2, with a normalized, p normalized. Karatsuba: with a = a0 + a1*B^h, a^2 = a0^2 + ((a0 + a1)^2 - a0^2 - a1^2)*B^h + a1^2*B^2h.
+// The scratch needs 4*n + 8*log2(n) vectors.
+static void sqr52(__m512i* p, const __m512i* a, const int n, __m512i* scratch)
+{
+	if (n < KARATSUBA_THRESHOLD)
+	{
+		sqr52Basecase(p, a, n);
+		return;
+	}
+	const __m512i zero = _mm512_setzero_si512();
+	const int h = n/2, hh = n - h; // hh is h or h + 1
+	__m512i* s = scratch; // hh + 1 limbs
+	__m512i* z1 = scratch + hh + 1; // 2*hh + 2 limbs
+	__m512i* next = z1 + 2*hh + 2;
+	for (int j = 0; j < hh; ++j) s[j] = j < h ? a[j] : zero;
+	s[hh] = addNormalize(s, s, a + h, hh, zero);
+	sqr52(p, a, h, next);
+	sqr52(p + 2*h, a + h, hh, next);
+	sqr52(z1, s, hh + 1, next);
+	// z1 -= a0^2 and z1 -= a1^2, then p += z1*B^h (the carry propagates to the end)
+	for (int j = 0; j < 2*h; ++j) next[j] = _mm512_sub_epi64(zero, p[j]);
+	for (int j = 2*h; j < 2*hh + 2; ++j) next[j] = zero;
+	__m512i carry = addNormalize(z1, z1, next, 2*hh + 2, zero);
+	for (int j = 0; j < 2*hh; ++j) next[j] = _mm512_sub_epi64(zero, p[2*h + j]);
+	next[2*hh] = next[2*hh + 1] = zero;
+	carry = addNormalize(z1, z1, next, 2*hh + 2, zero);
+	const int overlap = 2*n - h < 2*hh + 2 ? 2*n - h : 2*hh + 2;
+	carry = addNormalize(p + h, p + h, z1, overlap, zero);
+	for (int j = h + overlap; j < 2*n; ++j) carry = addNormalize(p + j, p + j, &zero, 1, carry);
+}
+
+// x = t/2^(52*L) mod N, for t[0 to 2L] with t < 16*N^2 (so the result is lower than 2*N). t is modified.
+static inline void redc52(__m512i* x, __m512i* t, const __m512i* n, const __m512i ninv, const int L)
+{
+	const __m512i zero = _mm512_setzero_si512();
+	for (int i = 0; i < L; ++i)
+	{
+		const __m512i m = _mm512_madd52lo_epu64(zero, t[i], ninv);
+		for (int j = 0; j < L; ++j)
+		{
+			t[i + j] = _mm512_madd52lo_epu64(t[i + j], n[j], m);
+			t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], n[j], m);
+		}
+		t[i + 1] = _mm512_add_epi64(t[i + 1], srli52(t[i])); // The low 52 bits of t[i] are now 0
+	}
+	const __m512i mask = _mm512_set1_epi64(mask52);
+	__m512i carry = zero;
+	for (int j = 0; j < L; ++j)
+	{
+		const __m512i v = _mm512_add_epi64(t[L + j], carry);
+		x[j] = _mm512_and_si512(v, mask);
+		carry = srli52(v);
+	}
+}
+
+// x = 2*x for the lanes selected by k.
+static inline void double52(__m512i* x, const __mmask8 k, const int L)
+{
+	const __m512i mask = _mm512_set1_epi64(mask52);
+	__m512i carry = _mm512_setzero_si512();
+	for (int j = 0; j < L; ++j)
+	{
+		const __m512i v = _mm512_add_epi64(_mm512_mask_slli_epi64(x[j], k, x[j], 1), carry);
+		x[j] = _mm512_and_si512(v, mask);
+		carry = srli52(v);
+	}
+}
+
+// Thread local to not use too much stack with the large sizes
+thread_local __m512i ifmaN[MAX_L52], ifmaX[MAX_L52], ifmaT[2*MAX_L52 + 2], ifmaScratch[4*MAX_L52 + 128];
+
+// Bit length of a number stored as n32 32 bits limbs.
+static int bitLength(const uint32_t* m, int n32)
+{
+	while (n32 > 1 && m[n32 - 1] == 0) --n32;
+	return 32*n32 - (m[n32 - 1] ? __builtin_clz(m[n32 - 1]) : 32);
+}
+
+// Tests 8 numbers. They can have different bit sizes, the limbs are then the ones of the largest.
+static void fermatTest8(int N_Size, const uint32_t* M, uint32_t* is_prime)
+{
+	int laneBits[IFMA_LANES], bits = 0;
+	for (int lane = 0; lane < IFMA_LANES; ++lane)
+	{
+		laneBits[lane] = bitLength(&M[lane*N_Size], N_Size);
+		if (laneBits[lane] > bits) bits = laneBits[lane];
+	}
+	const int L = (bits + 4 + 51)/52;
+	alignas(64) uint64_t ninvl[IFMA_LANES];
+	__m512i *n = ifmaN, *x = ifmaX, *t = ifmaT;
+	for (int lane = 0; lane < IFMA_LANES; ++lane)
+	{
+		const uint32_t* m = &M[lane*N_Size];
+		uint64_t limbs[MAX_L52];
+		toLimbs52(m, N_Size, limbs, L);
+		for (int k = 0; k < L; ++k) ((uint64_t*) &n[k])[lane] = limbs[k];
+
+		// -1/N mod 2^52 by Newton's iteration (N*N = 1 mod 8 for any odd N)
+		uint64_t inv = limbs[0];
+		for (int i = 0; i < 5; ++i) inv *= 2 - limbs[0]*inv;
+		ninvl[lane] = -inv & mask52;
+
+		// 2 in Montgomery Form, 2^(52*L + 1) mod N, which accounts for the leading 1 of the exponent.
+		// A lane with less bits starts with 1 in Montgomery Form instead, 2^(52*L) mod N, and stays 1 until its leading 1.
+		mp_limb_t d[IFMA_MAX_N_SIZE/2 + 1] = {0}, num[MAX_L52 + 2] = {0}, q[MAX_L52 + 2], r[IFMA_MAX_N_SIZE/2 + 1] = {0};
+		memcpy(d, m, N_Size*4);
+		mp_size_t dn = (N_Size + 1)/2;
+		while (dn > 1 && d[dn - 1] == 0) --dn;
+		const int bitPos = 52*L + (laneBits[lane] == bits);
+		const mp_size_t nn = bitPos/64 + 1;
+		num[bitPos/64] = 1ULL << (bitPos % 64);
+		mpn_tdiv_qr(q, r, 0, num, nn, d, dn);
+		toLimbs52((const uint32_t*) r, 2*dn, limbs, L);
+		for (int k = 0; k < L; ++k) ((uint64_t*) &x[k])[lane] = limbs[k];
+	}
+	const __m512i ninv = _mm512_load_si512(ninvl);
+
+	// Left to right exponentiation of 2^(N - 1), the bits of N - 1 are the ones of N except the last one which is 0. Each lane is doubled according to its own bits.
+	for (int i = bits - 2; i >= 0; --i)
+	{
+		sqr52(t, x, L, ifmaScratch);
+		t[2*L] = t[2*L + 1] = _mm512_setzero_si512();
+		redc52(x, t, n, ninv, L);
+		if (i > 0)
+		{
+			const __mmask8 k = _mm512_test_epi64_mask(n[i/52], _mm512_set1_epi64(1ULL << (i % 52)));
+			if (k) double52(x, k, L);
+		}
+	}
+
+	// Leave the Montgomery Form, the result is then at most N, and 2^(N - 1) mod N = 1 if the number is a probable prime.
+	for (int k = 0; k <= 2*L + 1; ++k) t[k] = k < L ? x[k] : _mm512_setzero_si512();
+	redc52(x, t, n, ninv, L);
+	__mmask8 isOne = _mm512_cmpeq_epi64_mask(x[0], _mm512_set1_epi64(1));
+	for (int k = 1; k < L; ++k) isOne &= _mm512_cmpeq_epi64_mask(x[k], _mm512_setzero_si512());
+	for (int lane = 0; lane < IFMA_LANES; ++lane) is_prime[lane] = (isOne >> lane) & 1;
+}
+
+void fermatTestIfma(int N_Size, int listSize, uint32_t* M, uint32_t* is_prime)
+{
+	if (N_Size < 1 || N_Size > IFMA_MAX_N_SIZE)
+	{
+		printf("N Size out of bounds\n");
+		abort();
+	}
+
+	if (listSize % JOB_SIZE)
+	{
+		printf("Incorrect list size alignment\n");
+		abort();
+	}
+
+	while (listSize > 0)
+	{
+		fermatTest8(N_Size, M, is_prime);
+		M += IFMA_LANES*N_Size;
+		is_prime += IFMA_LANES;
+		listSize -= IFMA_LANES;
+	}
+}
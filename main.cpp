@@ -124,6 +124,50 @@ bool Configuration::parse(const int argc, char** argv, std::string &parsingMessa
 			try {_options.stellaConfig.sieveWorkers = std::stoi(value);}
 			catch (...) {_options.stellaConfig.sieveWorkers = 0;}
 		}
+		else if (key == "SievePartitions") {
+			try {_options.stellaConfig.sievePartitions = std::stoi(value);}
+			catch (...) {_options.stellaConfig.sievePartitions = 1;}
+		}
+		else if (key == "PipelineDepth") {
+			try {_options.stellaConfig.pipelineDepth = std::stoi(value);}
+			catch (...) {_options.stellaConfig.pipelineDepth = 2;}
+		}
+		else if (key == "CoreClasses") {
+			for (uint16_t i(0) ; i < value.size() ; i++) {if (value[i] == ',') value[i] = ' ';}
+			std::stringstream classes(value);
+			std::vector<Stella::CoreClass> coreClasses;
+			std::string tmp;
+			while (classes >> tmp) coreClasses.push_back(tmp == "E" ? Stella::CoreClass::Efficiency : Stella::CoreClass::Performance);
+			_options.stellaConfig.coreClasses = coreClasses;
+		}
+		else if (key == "BackpressureQueuePerThread") {
+			try {_options.stellaConfig.backpressureQueuePerThread = std::stoi(value);}
+			catch (...) {_options.stellaConfig.backpressureQueuePerThread = 4;}
+		}
+		else if (key == "BackpressureMaxStaleTime") {
+			try {_options.stellaConfig.backpressureMaxStaleTime = std::stod(value);}
+			catch (...) {_options.stellaConfig.backpressureMaxStaleTime = 0.25;}
+		}
+		else if (key == "CandidatesPoolSize") {
+			try {_options.stellaConfig.candidatesPoolSize = std::stoll(value);}
+			catch (...) {_options.stellaConfig.candidatesPoolSize = 256;}
+		}
+		else if (key == "JobPrefetch") {
+			try {_options.stellaConfig.jobPrefetch = std::stoi(value);}
+			catch (...) {_options.stellaConfig.jobPrefetch = 2;}
+		}
+		else if (key == "AdaptiveSieveDepth") {
+			if (value == "No")
+				_options.stellaConfig.adaptiveSieveDepth = false;
+			else
+				_options.stellaConfig.adaptiveSieveDepth = true;
+		}
+		else if (key == "SieveLayout") {
+			if (value == "Interleaved")
+				_options.stellaConfig.interleavedSieveLayout = true;
+			else
+				_options.stellaConfig.interleavedSieveLayout = false;
+		}
 		else if (key == "SieveBits") {
 			try {_options.stellaConfig.sieveBits = std::stoi(value);}
 			catch (...) {_options.stellaConfig.sieveBits = 0;}
@@ -271,7 +315,7 @@ int main(int argc, char** argv) {
 	           "Processor: "s + Stella::sysInfo.getCpuBrand() + "\n"s);
 	if (Stella::sysInfo.getCpuArchitecture() == "x64") {
 		logger.log("Best SIMD instructions supported by the CPU: "s);
-		if (Stella::sysInfo.hasAVX512()) logger.log("AVX-512"s);
+		if (Stella::sysInfo.hasAVX512()) logger.log(Stella::sysInfo.hasAVX512IFMA() ? "AVX-512 with IFMA"s : "AVX-512"s);
 		else if (Stella::sysInfo.hasAVX2()) logger.log("AVX2"s);
 		else if (Stella::sysInfo.hasAVX()) logger.log("AVX"s);
 		else logger.log("None"s);
@@ -293,6 +337,18 @@ int main(int argc, char** argv) {
 	else
 		logger.log(Stella::doubleToString(physicalMemory/1048576., 3) + " MiB"s);
 	logger.log("\n"s);
+	if (Stella::sysInfo.getL3CacheSize() > 0 || Stella::sysInfo.getL2CacheSize() > 0) {
+		const auto formattedCacheSize([](const uint64_t size) {return size >= 1048576ULL ? Stella::doubleToString(static_cast<double>(size)/1048576., 1) + " MiB"s : std::to_string(size/1024ULL) + " KiB"s;});
+		logger.log("Caches: L1D "s + formattedCacheSize(Stella::sysInfo.getL1DataCacheSize()) + ", L2 "s + formattedCacheSize(Stella::sysInfo.getL2CacheSize()));
+		if (Stella::sysInfo.getL3CacheSize() > 0)
+			logger.log(", L3 "s + formattedCacheSize(Stella::sysInfo.getL3CacheSize()) + " (shared by "s + std::to_string(Stella::sysInfo.getL3SharingThreads()) + " thread(s))"s);
+		logger.log("\n"s);
+	}
+	const std::vector<Stella::CoreClass> coreClasses(Stella::sysInfo.getCoreClasses());
+	if (!coreClasses.empty()) {
+		const auto nEfficiencyCores(std::count(coreClasses.begin(), coreClasses.end(), Stella::CoreClass::Efficiency));
+		logger.log("Hybrid CPU: "s + std::to_string(coreClasses.size() - nEfficiencyCores) + " Performance and "s + std::to_string(nEfficiencyCores) + " Efficiency logical CPUs\n"s);
+	}
 	logger.hr();
 	
 	std::string parsingMessages;
@@ -380,7 +436,7 @@ int main(int argc, char** argv) {
 	std::chrono::time_point<std::chrono::steady_clock> timer, miningStartTp;
 	running = true;
 	bool keepStats(false);
-	uint64_t nBlocks(0ULL);
+	uint64_t nBlocks(0ULL), pseudoprimes(0ULL);
 	uint32_t currentHeight(0U);
 	if (client->isNetworked()) {
 		std::shared_ptr<API> api(nullptr);
@@ -484,15 +540,24 @@ int main(int argc, char** argv) {
 					stellaInstance->addJob(job.value());
 				}
 			}
-			// Push new Job if needed.
-			else if (stellaInstance->availableJobs() == 0ULL) {
-				const std::optional<Stella::Job> job(client->getJob());
+			// Push new Jobs if needed, so the next ones are already there when the Miner is done with the current one.
+			else if (stellaInstance->needsJobs()) {
+				std::optional<Stella::Job> job;
+				do {
+					job = client->getJob();
+					if (!job.has_value())
+						break;
+					stellaInstance->addJob(job.value());
+				} while (stellaInstance->needsJobs());
 				if (!job.has_value()) // Connection issue will be handled in the next iteration.
 					continue;
-				stellaInstance->addJob(job.value());
 			}
 			
 			// Handle submissions and let Client do its processing iteration.
+			const Stella::VerificationStats verificationStats(stellaInstance->getVerificationStats());
+			if (verificationStats.pseudoprimes > pseudoprimes) // Very rare, the Result is then submitted with the correct prime count or not at all
+				logger.log(Stella::formattedClockTimeNow() + " Base 2 Fermat pseudoprime(s) detected by the verification, "s + std::to_string(verificationStats.discardedResults) + " Result(s) discarded so far\n"s, MessageType::WARNING);
+			pseudoprimes = verificationStats.pseudoprimes; // Also handles the reset after a restart
 			const std::vector<Stella::Result> pendingSubmissions(stellaInstance->getResults());
 			for (const auto &submission : pendingSubmissions)
 				client->handleResult(submission);
@@ -522,11 +587,14 @@ int main(int argc, char** argv) {
 					message += " ("s + Stella::doubleToString(cps, 1U) + " c/s, r "s + Stella::doubleToString(r, 2U) + "), (1-"s + std::to_string(tupleCounts.size() - 1) + "t) = "s + Stella::formattedCounts(stellaInstance->getTupleCounts(), 1ULL);
 				}
 				logger.log(message + "\n"s);
-				if (api)
+				if (api) {
 					api->setStats(duration, r, cps, 86400./estimatedAverageBlockTime);
+					api->setWorkSwitchLatencies(stellaInstance->getWorkSwitchLatencies());
+					api->setBackpressureStats(stellaInstance->getBackpressureStats());
+				}
 				timer = std::chrono::steady_clock::now();
 			}
-			std::this_thread::sleep_for(pollInterval);
+			stellaInstance->waitForJobRequest(pollInterval); // Or sleep, but get the next Jobs quickly if needed
 		}
 		if (api) {
 			if (api->running())
@@ -579,10 +647,12 @@ int main(int argc, char** argv) {
 				logger.log(Stella::formattedTime(Stella::timeSince(miningStartTp)));
 				logger.log(" Block "s + std::to_string(currentHeight) + ", difficulty "s + Stella::doubleToString(clientInfo.difficulty, 6) + "\n"s);
 			}
-			// Get new Job if needed.
-			else if (stellaInstance->availableJobs() == 0ULL) {
-				job = client->getJob().value();
-				stellaInstance->addJob(job);
+			// Get new Jobs if needed.
+			else {
+				while (stellaInstance->needsJobs()) {
+					job = client->getJob().value();
+					stellaInstance->addJob(job);
+				}
 			}
 			
 			// Handle submissions and let Client do its processing iteration.
@@ -636,6 +706,20 @@ int main(int argc, char** argv) {
 						}
 					}
 					logger.log(tuplesFoundStr + "\n"s + tupleRatesStr + "\n"s + tupleRatiosStr + "\n"s);
+					const std::array<double, 3> phaseTimes(stellaInstance->getPhaseTimes());
+					logger.log("Time spent by the threads: "s + Stella::doubleToString(phaseTimes[0], 3U) + " s presieving, "s + Stella::doubleToString(phaseTimes[1], 3U) + " s sieving, "s + Stella::doubleToString(phaseTimes[2], 3U) + " s testing candidates\n"s);
+					if (stellaInstance->coreClassScheduling()) {
+						const std::array<double, 3> efficiencyPhaseTimes(stellaInstance->getEfficiencyPhaseTimes());
+						logger.log("Including by the Efficiency Workers: "s + Stella::doubleToString(efficiencyPhaseTimes[0], 3U) + " s presieving, "s + Stella::doubleToString(efficiencyPhaseTimes[1], 3U) + " s sieving, "s + Stella::doubleToString(efficiencyPhaseTimes[2], 3U) + " s testing candidates\n"s);
+					}
+					const Stella::VerificationStats verificationStats(stellaInstance->getVerificationStats());
+					logger.log("Results verified with the consensus test: "s + std::to_string(verificationStats.results) + " ("s + std::to_string(verificationStats.discardedResults) + " discarded, "s + std::to_string(verificationStats.pseudoprimes) + " pseudoprime(s)), latency "s + Stella::doubleToString(1000.*verificationStats.averageLatency, 3U) + " ms on average, "s + Stella::doubleToString(1000.*verificationStats.maxLatency, 3U) + " ms max\n"s);
+					logger.log("Work switch latencies after the Blocks: "s + Stella::formattedWorkSwitchLatencies(stellaInstance->getWorkSwitchLatencies()) + "\n"s);
+					logger.log("Backpressure Controller: "s + Stella::formattedBackpressureStats(stellaInstance->getBackpressureStats()) + "\n"s);
+					const Stella::JobStats jobStats(stellaInstance->getJobStats());
+					logger.log("Jobs started: "s + std::to_string(jobStats.jobs) + ", waited for them "s + Stella::doubleToString(jobStats.jobWaitTime, 3U) + " s, threads idle "s + Stella::doubleToString(jobStats.idleTime, 3U) + " s ("s + Stella::doubleToString(jobStats.jobs > 0 ? 1000.*jobStats.idleTime/static_cast<double>(jobStats.jobs) : 0., 3U) + " ms per Job)\n"s);
+					if (stellaConfig.adaptiveSieveDepth)
+						logger.log("Sieving up to p = "s + std::to_string(stellaInstance->getEffectivePrimeTableLimit()) + " at the end\n"s);
 					stellaInstance->stop();
 					running = false;
 					break;
@@ -660,7 +744,7 @@ int main(int argc, char** argv) {
 				logger.log(message + "\n"s);
 				timer = std::chrono::steady_clock::now();
 			}
-			std::this_thread::sleep_for(pollInterval);
+			stellaInstance->waitForJobRequest(pollInterval); // Or sleep, but get the next Jobs quickly if needed
 		}
 	}
 	return 0;